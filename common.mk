@@ -1,6 +1,7 @@
 COMMON_DIR = common
 SRC +=	$(COMMON_DIR)/host.c \
 	$(COMMON_DIR)/keyboard.c \
+	$(COMMON_DIR)/event_queue.c \
 	$(COMMON_DIR)/action.c \
 	$(COMMON_DIR)/action_tapping.c \
 	$(COMMON_DIR)/action_oneshot.c \
@@ -63,6 +64,21 @@ ifdef SLEEP_LED_ENABLE
     OPT_DEFS += -DNO_SUSPEND_POWER_DOWN
 endif
 
+ifdef LATENCY_TRACE_ENABLE
+    SRC += $(COMMON_DIR)/latency.c
+    OPT_DEFS += -DLATENCY_TRACE_ENABLE
+endif
+
+ifdef TRACE_ENABLE
+    SRC += $(COMMON_DIR)/trace.c
+    OPT_DEFS += -DTRACE_ENABLE
+endif
+
+ifdef MATRIX_SETTLE_CALIBRATE
+    SRC += $(COMMON_DIR)/matrix_settle.c
+    OPT_DEFS += -DMATRIX_SETTLE_CALIBRATE
+endif
+
 ifdef BACKLIGHT_ENABLE
     SRC += $(COMMON_DIR)/backlight.c
     OPT_DEFS += -DBACKLIGHT_ENABLE
@@ -26,6 +26,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "action_oneshot.h"
 #include "action_macro.h"
 #include "action.h"
+#include "latency.h"
+#include "trace.h"
 
 #ifdef DEBUG_ACTION
 #include "debug.h"
@@ -39,6 +41,9 @@ void action_exec(keyevent_t event)
     if (!IS_NOEVENT(event)) {
         dprint("\n---- action_exec: start -----\n");
         dprint("EVENT: "); debug_event(event); dprintln();
+        latency_event(event);
+        trace_key(event);
+        latency_mark(LATENCY_ACTION);
     }
 
     keyrecord_t record = { .event = event };
@@ -61,8 +66,13 @@ void process_action(keyrecord_t *record)
 #endif
 
     if (IS_NOEVENT(event)) { return; }
+#ifndef NO_ACTION_TAPPING
+    trace_process(event, record->tap);
+#else
+    trace_process(event, (tap_t){});
+#endif
 
-    action_t action = layer_switch_get_action(event.key);
+    action_t action = store_or_get_action(event.pressed, event.key);
     dprint("ACTION: "); debug_action(action);
 #ifndef NO_ACTION_LAYER
     dprint(" layer_state: "); layer_debug();
@@ -508,7 +518,7 @@ bool sending_anykey(void)
 
 bool is_tap_key(key_t key)
 {
-    action_t action = layer_switch_get_action(key);
+    action_t action = held_key_action(key);
 
     switch (action.kind.id) {
         case ACT_LMODS_TAP:
@@ -3,6 +3,9 @@
 #include "action.h"
 #include "util.h"
 #include "action_layer.h"
+#include "matrix.h"
+#include "timer.h"
+#include "trace.h"
 
 #ifdef DEBUG_ACTION
 #include "debug.h"
@@ -11,6 +14,12 @@
 #endif
 
 
+#ifndef NO_ACTION_CACHE
+static void clear_stuck_keys(void);
+#else
+#define clear_stuck_keys()  clear_keyboard_but_mods() // To avoid stuck keys
+#endif
+
 /* 
  * Default Layer State
  */
@@ -21,8 +30,9 @@ static void default_layer_state_set(uint32_t state)
     debug("default_layer_state: ");
     default_layer_debug(); debug(" to ");
     default_layer_state = state;
+    trace_layer(TRACE_DEFAULT, state);
     default_layer_debug(); debug("\n");
-    clear_keyboard_but_mods(); // To avoid stuck keys
+    clear_stuck_keys();
 }
 
 void default_layer_debug(void)
@@ -62,8 +72,9 @@ static void layer_state_set(uint32_t state)
     dprint("layer_state: ");
     layer_debug(); dprint(" to ");
     layer_state = state;
+    trace_layer(TRACE_LAYER, state);
     layer_debug(); dprintln();
-    clear_keyboard_but_mods(); // To avoid stuck keys
+    clear_stuck_keys();
 }
 
 void layer_clear(void)
@@ -136,3 +147,106 @@ action_t layer_switch_get_action(key_t key)
     return action;
 #endif
 }
+
+
+#ifndef NO_ACTION_CACHE
+/*
+ * Action Cache
+ *
+ * Action of a key is resolved at press and kept until its release, so that
+ * release doesn't walk layers again and undoes what press did even if layer
+ * state has changed in between.
+ */
+typedef struct {
+    key_t key;
+    action_t action;
+} held_action_t;
+
+#define LAYERS  (layer_state | default_layer_state)
+
+static held_action_t held[ACTION_CACHE_SIZE];
+static uint8_t held_count = 0;
+/* held keys not in cache: pressed while cache was full or before cleared */
+static matrix_row_t uncached[MATRIX_ROWS];
+
+/* last action resolved by held_key_action(), likely of press coming next */
+static held_action_t peek;
+static uint32_t peek_layers;
+static bool peek_valid = false;
+
+static int8_t held_find(key_t key)
+{
+    for (uint8_t i = 0; i < held_count; i++) {
+        if (KEYEQ(held[i].key, key)) return i;
+    }
+    return -1;
+}
+
+action_t store_or_get_action(bool pressed, key_t key)
+{
+    int8_t i = held_find(key);
+    action_t action;
+
+    if (pressed) {
+        if (peek_valid && KEYEQ(peek.key, key) && peek_layers == LAYERS) {
+            action = peek.action;
+        } else {
+            action = layer_switch_get_action(key);
+        }
+        peek_valid = false;
+
+        if (i < 0) {
+            if (held_count == ACTION_CACHE_SIZE) {
+                debug("action_cache: full\n");
+                uncached[key.row] |= MATRIX_ROW_BIT(key.col);
+                return action;
+            }
+            i = held_count++;
+        }
+        uncached[key.row] &= ~MATRIX_ROW_BIT(key.col);
+        held[i] = (held_action_t){ .key = key, .action = action };
+        return action;
+    }
+
+    if (i < 0) {
+        uncached[key.row] &= ~MATRIX_ROW_BIT(key.col);
+        return layer_switch_get_action(key);
+    }
+    action = held[i].action;
+    held[i] = held[--held_count];
+    return action;
+}
+
+action_t held_key_action(key_t key)
+{
+    int8_t i = held_find(key);
+    if (i >= 0) {
+        return held[i].action;
+    }
+    peek.key = key;
+    peek.action = layer_switch_get_action(key);
+    peek_layers = LAYERS;
+    peek_valid = true;
+    return peek.action;
+}
+
+void action_cache_clear(void)
+{
+    while (held_count) {
+        key_t key = held[--held_count].key;
+        uncached[key.row] |= MATRIX_ROW_BIT(key.col);
+    }
+    peek_valid = false;
+}
+
+/* Only keys missing in cache can stick on layer change */
+static void clear_stuck_keys(void)
+{
+    for (uint8_t r = 0; r < MATRIX_ROWS; r++) {
+        if (uncached[r]) {
+            clear_keyboard_but_mods();
+            return;
+        }
+    }
+}
+#endif
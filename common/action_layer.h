@@ -18,6 +18,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define ACTION_LAYER_H
 
 #include <stdint.h>
+#include <stdbool.h>
 #include "keyboard.h"
 #include "action.h"
 
@@ -74,4 +75,25 @@ void layer_xor(uint32_t state);
 /* return action depending on current layer status */
 action_t layer_switch_get_action(key_t key);
 
+
+/*
+ * Action Cache
+ */
+#ifndef ACTION_CACHE_SIZE
+#define ACTION_CACHE_SIZE   10
+#endif
+
+#ifndef NO_ACTION_CACHE
+/* resolve action on press and return the same action on its release */
+action_t store_or_get_action(bool pressed, key_t key);
+/* action of held key, or depending on current layer status */
+action_t held_key_action(key_t key);
+/* forget actions of held keys; their release resolves action again */
+void action_cache_clear(void);
+#else
+#define store_or_get_action(pressed, key)   layer_switch_get_action(key)
+#define held_key_action(key)                layer_switch_get_action(key)
+#define action_cache_clear()
+#endif
+
 #endif
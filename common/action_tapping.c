@@ -2,6 +2,7 @@
 #include <stdbool.h>
 #include "action.h"
 #include "action_tapping.h"
+#include "action_layer.h"
 #include "timer.h"
 
 #ifdef DEBUG_ACTION
@@ -16,7 +17,10 @@
 #define IS_TAPPING_PRESSED()    (IS_TAPPING() && tapping_key.event.pressed)
 #define IS_TAPPING_RELEASED()   (IS_TAPPING() && !tapping_key.event.pressed)
 #define IS_TAPPING_KEY(k)       (IS_TAPPING() && KEYEQ(tapping_key.event.key, (k)))
-#define WITHIN_TAPPING_TERM(e)  (TIMER_DIFF_16(e.time, tapping_key.event.time) < TAPPING_TERM)
+#define TAPPING_ELAPSED(e)      TIMER_DIFF_16(e.time, tapping_key.event.time)
+// compare Timer0 count of both events at the boundary ms
+#define WITHIN_TAPPING_TERM(e)  (TAPPING_ELAPSED(e) < TAPPING_TERM || \
+                                 (TAPPING_ELAPSED(e) == TAPPING_TERM && e.time_fine < tapping_key.event.time_fine))
 
 
 static keyrecord_t tapping_key = {};
@@ -47,6 +51,7 @@ void action_tapping_process(keyrecord_t record)
             // clear all in case of overflow.
             debug("OVERFLOW: CLEAR ALL STATES\n");
             clear_keyboard();
+            action_cache_clear();
             waiting_buffer_clear();
             tapping_key = (keyrecord_t){};
         }
@@ -136,6 +141,7 @@ bool process_tapping(keyrecord_t *keyp)
                                 .tap = tapping_key.tap,
                                 .event.key = tapping_key.event.key,
                                 .event.time = event.time,
+                                .event.time_fine = event.time_fine,
                                 .event.pressed = false
                         });
                     } else {
@@ -180,6 +186,7 @@ bool process_tapping(keyrecord_t *keyp)
                                 .tap = tapping_key.tap,
                                 .event.key = tapping_key.event.key,
                                 .event.time = event.time,
+                                .event.time_fine = event.time_fine,
                                 .event.pressed = false
                         });
                     } else {
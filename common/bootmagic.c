@@ -99,11 +99,10 @@ static bool scan_keycode(uint8_t keycode)
 {
     for (uint8_t r = 0; r < MATRIX_ROWS; r++) {
         matrix_row_t matrix_row = matrix_get_row(r);
-        for (uint8_t c = 0; c < MATRIX_COLS; c++) {
-            if (matrix_row & ((matrix_row_t)1<<c)) {
-                if (keycode == keymap_key_to_keycode(0, (key_t){ .row = r, .col = c })) {
-                    return true;
-                }
+        for (; matrix_row; matrix_row &= matrix_row - 1) {
+            uint8_t c = MATRIX_ROW_BITCTZ(matrix_row);
+            if (keycode == keymap_key_to_keycode(0, (key_t){ .row = r, .col = c })) {
+                return true;
             }
         }
     }
@@ -32,6 +32,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "led.h"
 #include "command.h"
 #include "backlight.h"
+#include "latency.h"
+#include "trace.h"
+#ifdef DEBOUNCE_ADAPTIVE
+#include "debounce.h"
+#endif
 
 #ifdef MOUSEKEY_ENABLE
 #include "mousekey.h"
@@ -114,6 +119,16 @@ static void command_common_help(void)
     print("t:	print timer count\n");
     print("s:	print status\n");
     print("e:	print eeprom config\n");
+#ifdef LATENCY_TRACE_ENABLE
+    print("l:	print latency trace and clear\n");
+#endif
+#ifdef TRACE_ENABLE
+    print("r:	dump event trace\n");
+#endif
+#ifdef DEBOUNCE_ADAPTIVE
+    print("b:	print chattering keys\n");
+    print("f:	forget chattering keys\n");
+#endif
 #ifdef NKRO_ENABLE
     print("n:	toggle NKRO\n");
 #endif
@@ -158,6 +173,10 @@ static void print_eeconfig(void)
     print(".enable: "); print_dec(bc.enable); print("\n");
     print(".level: "); print_dec(bc.level); print("\n");
 #endif
+
+#ifdef MATRIX_SETTLE_CALIBRATE
+    print("matrix_settle(us): "); print_dec(eeconfig_read_matrix_settle()); print("\n");
+#endif
 }
 #endif
 
@@ -178,6 +197,26 @@ static bool command_common(uint8_t code)
             print("eeconfig:\n");
             print_eeconfig();
             break;
+#endif
+#ifdef TRACE_ENABLE
+        case KC_R:
+            trace_dump();
+            break;
+#endif
+#ifdef DEBOUNCE_ADAPTIVE
+        case KC_B:
+            debounce_print();
+            break;
+        case KC_F:
+            debounce_clear();
+            print("chatter counts cleared\n");
+            break;
+#endif
+#ifdef LATENCY_TRACE_ENABLE
+        case KC_L:
+            latency_print();
+            latency_clear();
+            break;
 #endif
         case KC_CAPSLOCK:
             if (host_get_driver()) {
@@ -0,0 +1,402 @@
+/*
+Copyright 2013 Jun Wako <wakojun@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdint.h>
+#include <stdbool.h>
+#if defined(DEBOUNCE_ADAPTIVE) && defined(BOOTMAGIC_ENABLE) && defined(MATRIX_SCAN_ISR)
+#include <avr/interrupt.h>
+#endif
+#include "timer.h"
+#include "debug.h"
+#include "latency.h"
+#include "eeconfig.h"
+#include "debounce.h"
+
+
+#define DEBOUNCE_MAX    ((DEBOUNCE_PRESS > DEBOUNCE_RELEASE ? DEBOUNCE_PRESS : DEBOUNCE_RELEASE) + DEBOUNCE_EXTRA_MAX)
+
+/* keys whose raw state differed from matrix at last call */
+static matrix_row_t changing[MATRIX_ROWS];
+
+
+#ifdef DEBOUNCE_ADAPTIVE
+/*
+ * Adaptive debounce
+ *
+ * Step of extended time of each key is stored in two bit planes so that
+ * vertical counter can pick keys of a step with a few bit operations.
+ */
+static uint8_t chatter[MATRIX_ROWS][MATRIX_COLS];
+/* presses without chatter since last chatter or decay */
+static uint8_t clean[MATRIX_ROWS][MATRIX_COLS];
+static uint8_t release_time[MATRIX_ROWS][MATRIX_COLS];
+/* keys released within DEBOUNCE_ADAPTIVE_HOLD ms */
+static matrix_row_t recent[MATRIX_ROWS];
+static matrix_row_t step[2][MATRIX_ROWS];
+#ifdef BOOTMAGIC_ENABLE
+/* keys whose count is not written to EEPROM yet */
+static matrix_row_t unsaved[MATRIX_ROWS];
+#endif
+
+static inline uint8_t chatter_step(uint8_t count)
+{
+    uint8_t s = count / DEBOUNCE_ADAPTIVE_COUNT;
+    return (s > 3 ? 3 : s);
+}
+
+static void set_step(uint8_t row, uint8_t col, uint8_t s)
+{
+    matrix_row_t bit = MATRIX_ROW_BIT(col);
+    step[0][row] = (s & 1) ? (step[0][row] | bit) : (step[0][row] & ~bit);
+    step[1][row] = (s & 2) ? (step[1][row] | bit) : (step[1][row] & ~bit);
+}
+
+/* keys in step s */
+static inline matrix_row_t step_keys(uint8_t row, uint8_t s)
+{
+    return ((s & 1) ? step[0][row] : ~step[0][row]) &
+           ((s & 2) ? step[1][row] : ~step[1][row]);
+}
+
+/* extended time of a key */
+static inline uint8_t debounce_extra(uint8_t row, matrix_row_t bit)
+{
+    return ((step[0][row] & bit) ? DEBOUNCE_ADAPTIVE_STEP : 0) +
+           ((step[1][row] & bit) ? 2 * DEBOUNCE_ADAPTIVE_STEP : 0);
+}
+
+static void adaptive_init(void)
+{
+#ifdef BOOTMAGIC_ENABLE
+    bool saved = eeconfig_is_enabled();
+#endif
+    for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
+        recent[i] = 0;
+        for (uint8_t j = 0; j < MATRIX_COLS; j++) {
+            uint8_t count = 0;
+#ifdef BOOTMAGIC_ENABLE
+            if (saved) {
+                count = eeconfig_read_debounce(i, j);
+                // erased
+                if (count == 0xFF) count = 0;
+            }
+#endif
+            chatter[i][j] = count;
+            clean[i][j] = 0;
+            set_step(i, j, chatter_step(count));
+        }
+    }
+}
+
+static void adaptive_set(uint8_t row, uint8_t col, uint8_t count)
+{
+    uint8_t s = chatter_step(chatter[row][col]);
+    chatter[row][col] = count;
+    clean[row][col] = 0;
+    if (chatter_step(count) == s) return;
+
+    // EEPROM is written only when step changes, later by debounce_save()
+    set_step(row, col, chatter_step(count));
+#ifdef BOOTMAGIC_ENABLE
+    unsaved[row] |= MATRIX_ROW_BIT(col);
+#endif
+}
+
+static void adaptive_chatter(uint8_t row, uint8_t col)
+{
+#ifndef MATRIX_SCAN_ISR
+    // no print from scan interrupt
+    debug("chatter!: "); debug_hex(row); debug(" "); debug_hex(col); debug("\n");
+#endif
+    if (chatter[row][col] == 0xFF) return;
+    adaptive_set(row, col, chatter[row][col] + 1);
+}
+
+/* halve count every DEBOUNCE_ADAPTIVE_DECAY presses without chatter so that
+ * fast double taps don't extend debounce time for good */
+static void adaptive_clean(uint8_t row, uint8_t col)
+{
+    if (!chatter[row][col]) return;
+    if (++clean[row][col] < DEBOUNCE_ADAPTIVE_DECAY) return;
+    adaptive_set(row, col, chatter[row][col] / 2);
+}
+
+/* forget keys released DEBOUNCE_ADAPTIVE_HOLD ms ago */
+static void adaptive_expire(uint8_t row)
+{
+    uint8_t now = timer_read();
+    matrix_row_t keys = recent[row];
+    for (uint8_t col = 0; keys; col++, keys >>= 1) {
+        if (!(keys & 1)) continue;
+        if ((uint8_t)(now - release_time[row][col]) >= DEBOUNCE_ADAPTIVE_HOLD) {
+            recent[row] &= ~MATRIX_ROW_BIT(col);
+        }
+    }
+}
+
+/* key pressed again soon after release is chattering */
+static void adaptive_update(uint8_t row, matrix_row_t pressed, matrix_row_t released)
+{
+    uint8_t now = timer_read();
+    matrix_row_t chattered = pressed & recent[row];
+    recent[row] = (recent[row] & ~pressed) | released;
+
+    matrix_row_t keys = pressed | released;
+    for (uint8_t col = 0; keys; col++, keys >>= 1) {
+        if (!(keys & 1)) continue;
+        matrix_row_t bit = MATRIX_ROW_BIT(col);
+        if (released & bit) release_time[row][col] = now;
+        else if (chattered & bit) adaptive_chatter(row, col);
+        else adaptive_clean(row, col);
+    }
+}
+
+void debounce_print(void)
+{
+    print("\nr/c chatter debounce(ms)\n");
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+            if (!chatter[row][col]) continue;
+            print_hex8(row); print("/"); print_hex8(col); print(": ");
+            print_dec(chatter[row][col]); print(" ");
+            print_dec(DEBOUNCE_RELEASE + debounce_extra(row, MATRIX_ROW_BIT(col))); print("\n");
+        }
+    }
+}
+
+void debounce_clear(void)
+{
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+            if (chatter[row][col]) adaptive_set(row, col, 0);
+        }
+    }
+}
+
+#ifdef BOOTMAGIC_ENABLE
+void debounce_save(void)
+{
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        if (!unsaved[row]) continue;
+        for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+            matrix_row_t bit = MATRIX_ROW_BIT(col);
+            if (!(unsaved[row] & bit)) continue;
+#ifdef MATRIX_SCAN_ISR
+            // count can be changed by scan interrupt
+            cli();
+#endif
+            unsaved[row] &= ~bit;
+            uint8_t count = chatter[row][col];
+#ifdef MATRIX_SCAN_ISR
+            sei();
+#endif
+            eeconfig_write_debounce(row, col, count);
+            // a byte per call, EEPROM write takes a few ms
+            return;
+        }
+    }
+}
+#endif
+#else
+#define debounce_extra(row, bit)    0
+#endif
+
+
+#ifdef DEBOUNCE_VERTICAL_COUNTER
+/*
+ * Vertical counter
+ *
+ * Bit b of elapsed time of each key is stored in count[b] so that a whole
+ * row is counted with a few AND/XOR. Counter is advanced on each ms tick and
+ * stops at debounce time of the key.
+ */
+#if DEBOUNCE_MAX < 2
+#   define COUNT_BITS   1
+#elif DEBOUNCE_MAX < 4
+#   define COUNT_BITS   2
+#elif DEBOUNCE_MAX < 8
+#   define COUNT_BITS   3
+#elif DEBOUNCE_MAX < 16
+#   define COUNT_BITS   4
+#elif DEBOUNCE_MAX < 32
+#   define COUNT_BITS   5
+#elif DEBOUNCE_MAX < 64
+#   define COUNT_BITS   6
+#elif DEBOUNCE_MAX < 128
+#   define COUNT_BITS   7
+#else
+#   define COUNT_BITS   8
+#endif
+
+static matrix_row_t count[COUNT_BITS][MATRIX_ROWS];
+static uint8_t last_time[MATRIX_ROWS];
+
+/* keys whose count is n or more: compared from MSB */
+static inline matrix_row_t count_reached_n(uint8_t row, uint8_t n)
+{
+    matrix_row_t greater = 0;
+    matrix_row_t equal = ~(matrix_row_t)0;
+    for (int8_t b = COUNT_BITS - 1; b >= 0; b--) {
+        if (n & (1<<b)) {
+            equal &= count[b][row];
+        } else {
+            greater |= equal & count[b][row];
+            equal &= ~count[b][row];
+        }
+    }
+    return greater | equal;
+}
+
+/* keys on in matrix wait for release and others for press */
+static inline matrix_row_t count_reached(uint8_t row, matrix_row_t cooked)
+{
+#ifdef DEBOUNCE_ADAPTIVE
+    matrix_row_t reached = 0;
+    for (uint8_t s = 0; s < 4; s++) {
+        matrix_row_t keys = step_keys(row, s);
+        if (!keys) continue;
+        uint8_t extra = s * DEBOUNCE_ADAPTIVE_STEP;
+        reached |= ((count_reached_n(row, DEBOUNCE_RELEASE + extra) & cooked) |
+                    (count_reached_n(row, DEBOUNCE_PRESS + extra) & ~cooked)) & keys;
+    }
+    return reached;
+#else
+    return (count_reached_n(row, DEBOUNCE_RELEASE) & cooked) |
+           (count_reached_n(row, DEBOUNCE_PRESS) & ~cooked);
+#endif
+}
+
+static void debounce_reset(void)
+{
+    uint8_t now = timer_read();
+    for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
+        for (uint8_t b = 0; b < COUNT_BITS; b++) count[b][i] = 0;
+        last_time[i] = now;
+    }
+}
+
+static matrix_row_t debounce_elapsed(uint8_t row, matrix_row_t change, matrix_row_t cooked)
+{
+    uint8_t now = timer_read();
+    uint8_t ticks = now - last_time[row];
+    last_time[row] = now;
+
+    // count restarts from zero when key changes again
+    matrix_row_t counting = change & changing[row];
+    for (uint8_t b = 0; b < COUNT_BITS; b++) count[b][row] &= counting;
+
+    if (ticks > DEBOUNCE_MAX) ticks = DEBOUNCE_MAX;
+    while (ticks--) {
+        matrix_row_t carry = counting & ~count_reached(row, cooked);
+        if (!carry) break;
+        for (uint8_t b = 0; b < COUNT_BITS && carry; b++) {
+            matrix_row_t next = count[b][row] & carry;
+            count[b][row] ^= carry;
+            carry = next;
+        }
+    }
+    return change & count_reached(row, cooked);
+}
+
+#else
+/*
+ * Change time per key
+ *
+ * Time when key is read in new state first(ms, lower 8 bits), one byte per key.
+ */
+static uint8_t change_time[MATRIX_ROWS][MATRIX_COLS];
+
+static void debounce_reset(void)
+{
+}
+
+static matrix_row_t debounce_elapsed(uint8_t row, matrix_row_t change, matrix_row_t cooked)
+{
+    matrix_row_t done = 0;
+    uint8_t now = timer_read();
+    for (uint8_t col = 0; change; col++, change >>= 1) {
+        if (!(change & 1)) continue;
+
+        matrix_row_t bit = MATRIX_ROW_BIT(col);
+        if (!(changing[row] & bit)) {
+            change_time[row][col] = now;
+        }
+        uint8_t elapsed = now - change_time[row][col];
+        if (elapsed >= ((cooked & bit) ? DEBOUNCE_RELEASE : DEBOUNCE_PRESS) + debounce_extra(row, bit)) {
+            done |= bit;
+        }
+    }
+    return done;
+}
+#endif
+
+
+void debounce_init(void)
+{
+    for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
+        changing[i] = 0;
+    }
+    debounce_reset();
+#ifdef DEBOUNCE_ADAPTIVE
+    adaptive_init();
+#endif
+}
+
+bool debounce_idle(void)
+{
+    for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
+        if (changing[i]) return false;
+#ifdef DEBOUNCE_ADAPTIVE
+        // release time of recent keys can't be kept over timer wrap
+        if (recent[i]) return false;
+#endif
+    }
+    return true;
+}
+
+bool debounce_row(uint8_t row, matrix_row_t raw, matrix_row_t *matrix_row)
+{
+    matrix_row_t cooked = *matrix_row;
+
+#ifdef DEBOUNCE_ADAPTIVE
+    if (recent[row]) adaptive_expire(row);
+#endif
+    // no key is changing
+    if (raw == cooked && !changing[row]) return false;
+
+#if DEBOUNCE_PRESS == 0
+    // press at once
+    cooked |= raw;
+#endif
+    matrix_row_t change = raw ^ cooked;
+#ifndef MATRIX_SCAN_ISR
+    // no print from scan interrupt
+    if (changing[row] & ~change) {
+        debug("bounce!: "); debug_hex(row); debug("\n");
+    }
+#endif
+    matrix_row_t done = (change ? debounce_elapsed(row, change, cooked) : 0);
+    changing[row] = change & ~done;
+    cooked ^= done;
+
+    if (cooked == *matrix_row) return false;
+#ifdef DEBOUNCE_ADAPTIVE
+    adaptive_update(row, cooked & ~*matrix_row, *matrix_row & ~cooked);
+#endif
+    *matrix_row = cooked;
+    latency_mark(LATENCY_DEBOUNCE);
+    return true;
+}
@@ -0,0 +1,91 @@
+/*
+Copyright 2013 Jun Wako <wakojun@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef DEBOUNCE_H
+#define DEBOUNCE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "matrix.h"
+
+
+/* Per-key debounce
+ *
+ * Key state is changed when the key keeps new state for DEBOUNCE_PRESS or
+ * DEBOUNCE_RELEASE ms, measured with timer so that it doesn't depend on scan
+ * rate. Press is registered at first edge by default, so bounce of a key
+ * delays neither other keys nor its press. Scanner calls debounce_row() with
+ * raw state of each row and it never waits.
+ *
+ * Time is kept in a byte per key by default, or in vertical counters with
+ * DEBOUNCE_VERTICAL_COUNTER which count whole row at once.
+ *
+ * With DEBOUNCE_ADAPTIVE key which is pressed again within DEBOUNCE_ADAPTIVE_HOLD
+ * ms after release is counted as chatter, and debounce time of the key is
+ * extended by DEBOUNCE_ADAPTIVE_STEP ms every DEBOUNCE_ADAPTIVE_COUNT chatters,
+ * three steps at most. Count is halved every DEBOUNCE_ADAPTIVE_DECAY presses
+ * without chatter. Counts are saved in EEPROM with BOOTMAGIC_ENABLE, from main
+loop with debounce_save() since EEPROM write is slow.
+ */
+#ifndef DEBOUNCE
+#   define DEBOUNCE 5
+#endif
+#ifndef DEBOUNCE_PRESS
+#   define DEBOUNCE_PRESS   0
+#endif
+#ifndef DEBOUNCE_RELEASE
+#   define DEBOUNCE_RELEASE DEBOUNCE
+#endif
+
+#ifdef DEBOUNCE_ADAPTIVE
+#   ifndef DEBOUNCE_ADAPTIVE_HOLD
+#       define DEBOUNCE_ADAPTIVE_HOLD   20
+#   endif
+#   ifndef DEBOUNCE_ADAPTIVE_STEP
+#       define DEBOUNCE_ADAPTIVE_STEP   5
+#   endif
+#   ifndef DEBOUNCE_ADAPTIVE_COUNT
+#       define DEBOUNCE_ADAPTIVE_COUNT  4
+#   endif
+#   ifndef DEBOUNCE_ADAPTIVE_DECAY
+#       define DEBOUNCE_ADAPTIVE_DECAY  100
+#   endif
+#   define DEBOUNCE_EXTRA_MAX   (3 * DEBOUNCE_ADAPTIVE_STEP)
+#else
+#   define DEBOUNCE_EXTRA_MAX   0
+#endif
+
+#if DEBOUNCE_PRESS + DEBOUNCE_EXTRA_MAX > 255 || DEBOUNCE_RELEASE + DEBOUNCE_EXTRA_MAX > 255
+#   error "DEBOUNCE_PRESS and DEBOUNCE_RELEASE must not exceed 255ms"
+#endif
+
+void debounce_init(void);
+/* update matrix row with raw row state, returns true when matrix row is changed */
+bool debounce_row(uint8_t row, matrix_row_t raw, matrix_row_t *matrix_row);
+/* no key is waiting for debounce time */
+bool debounce_idle(void);
+#ifdef DEBOUNCE_ADAPTIVE
+/* print chatter count and extended debounce time of keys */
+void debounce_print(void);
+/* forget chatter counts of all keys */
+void debounce_clear(void);
+#ifdef BOOTMAGIC_ENABLE
+/* write a changed count to EEPROM, called from keyboard_task() */
+void debounce_save(void);
+#endif
+#endif
+
+#endif
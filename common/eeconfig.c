@@ -13,6 +13,15 @@ void eeconfig_init(void)
 #ifdef BACKLIGHT_ENABLE
     eeprom_write_byte(EECONFIG_BACKLIGHT,      0);
 #endif
+#ifdef MATRIX_SETTLE_CALIBRATE
+    // not measured yet
+    eeprom_write_byte(EECONFIG_MATRIX_SETTLE,  0xFF);
+#endif
+#ifdef DEBOUNCE_ADAPTIVE
+    for (uint16_t i = 0; i < MATRIX_ROWS * MATRIX_COLS; i++) {
+        eeprom_write_byte(EECONFIG_DEBOUNCE + i, 0);
+    }
+#endif
 }
 
 void eeconfig_enable(void)
@@ -43,3 +52,19 @@ void eeconfig_write_keymap(uint8_t val) { eeprom_write_byte(EECONFIG_KEYMAP, val
 uint8_t eeconfig_read_backlight(void)      { return eeprom_read_byte(EECONFIG_BACKLIGHT); }
 void eeconfig_write_backlight(uint8_t val) { eeprom_write_byte(EECONFIG_BACKLIGHT, val); }
 #endif
+
+#ifdef MATRIX_SETTLE_CALIBRATE
+uint8_t eeconfig_read_matrix_settle(void)      { return eeprom_read_byte(EECONFIG_MATRIX_SETTLE); }
+void eeconfig_write_matrix_settle(uint8_t val) { eeprom_write_byte(EECONFIG_MATRIX_SETTLE, val); }
+#endif
+
+#ifdef DEBOUNCE_ADAPTIVE
+uint8_t eeconfig_read_debounce(uint8_t row, uint8_t col)
+{
+    return eeprom_read_byte(EECONFIG_DEBOUNCE + row * MATRIX_COLS + col);
+}
+void eeconfig_write_debounce(uint8_t row, uint8_t col, uint8_t val)
+{
+    eeprom_write_byte(EECONFIG_DEBOUNCE + row * MATRIX_COLS + col, val);
+}
+#endif
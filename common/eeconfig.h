@@ -31,6 +31,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define EECONFIG_KEYMAP                             (uint8_t *)4
 #define EECONFIG_MOUSEKEY_ACCEL                     (uint8_t *)5
 #define EECONFIG_BACKLIGHT                          (uint8_t *)6
+#define EECONFIG_MATRIX_SETTLE                      (uint8_t *)7
+/* per-key area: MATRIX_ROWS * MATRIX_COLS bytes */
+#define EECONFIG_DEBOUNCE                           (uint8_t *)16
 
 
 /* debug bit */
@@ -71,4 +74,14 @@ uint8_t eeconfig_read_backlight(void);
 void eeconfig_write_backlight(uint8_t val);
 #endif
 
+#ifdef MATRIX_SETTLE_CALIBRATE
+uint8_t eeconfig_read_matrix_settle(void);
+void eeconfig_write_matrix_settle(uint8_t val);
+#endif
+
+#ifdef DEBOUNCE_ADAPTIVE
+uint8_t eeconfig_read_debounce(uint8_t row, uint8_t col);
+void eeconfig_write_debounce(uint8_t row, uint8_t col, uint8_t val);
+#endif
+
 #endif
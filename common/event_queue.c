@@ -0,0 +1,62 @@
+/*
+Copyright 2013 Jun Wako <wakojun@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdint.h>
+#include <stdbool.h>
+#include "keyboard.h"
+#include "event_queue.h"
+
+
+#define QUEUE_MASK  (EVENT_QUEUE_SIZE - 1)
+
+/* head is written only by producer and tail only by consumer.
+ * 8bit index read/write is atomic on AVR. */
+static keyevent_t queue[EVENT_QUEUE_SIZE];
+static volatile uint8_t queue_head = 0;
+static volatile uint8_t queue_tail = 0;
+
+/* keep buffer access from being reordered across index update */
+#define MEMORY_BARRIER()    __asm__ __volatile__ ("" ::: "memory")
+
+
+bool event_queue_enq(keyevent_t event)
+{
+    uint8_t head = queue_head;
+    uint8_t next = (head + 1) & QUEUE_MASK;
+    if (next == queue_tail) return false;
+
+    queue[head] = event;
+    MEMORY_BARRIER();
+    queue_head = next;
+    return true;
+}
+
+bool event_queue_deq(keyevent_t *event)
+{
+    uint8_t tail = queue_tail;
+    if (tail == queue_head) return false;
+
+    MEMORY_BARRIER();
+    *event = queue[tail];
+    MEMORY_BARRIER();
+    queue_tail = (tail + 1) & QUEUE_MASK;
+    return true;
+}
+
+bool event_queue_is_empty(void)
+{
+    return (queue_tail == queue_head);
+}
@@ -0,0 +1,46 @@
+/*
+Copyright 2013 Jun Wako <wakojun@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef EVENT_QUEUE_H
+#define EVENT_QUEUE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "keyboard.h"
+
+
+/* Key event queue
+ *
+ * Single producer/single consumer ring buffer. Producer can be interrupt
+ * context(scan timer) and consumer keyboard_task(); no lock is needed as long
+ * as each side has only one user.
+ */
+#ifndef EVENT_QUEUE_SIZE
+#define EVENT_QUEUE_SIZE    16
+#endif
+
+#if (EVENT_QUEUE_SIZE & (EVENT_QUEUE_SIZE - 1)) || (EVENT_QUEUE_SIZE > 128)
+#   error "EVENT_QUEUE_SIZE must be power of 2 and not exceed 128"
+#endif
+
+
+/* producer: return false when queue is full */
+bool event_queue_enq(keyevent_t event);
+/* consumer: return false when queue is empty */
+bool event_queue_deq(keyevent_t *event);
+bool event_queue_is_empty(void);
+
+#endif
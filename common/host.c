@@ -21,6 +21,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "host.h"
 #include "util.h"
 #include "debug.h"
+#include "latency.h"
+#include "trace.h"
 
 
 #ifdef NKRO_ENABLE
@@ -32,6 +34,7 @@ report_mouse_t mouse_report = {};
 
 
 static host_driver_t *driver;
+static volatile bool keyboard_leds_changed = true;
 static uint16_t last_system_report = 0;
 static uint16_t last_consumer_report = 0;
 
@@ -46,6 +49,7 @@ static inline void del_key_bit(uint8_t code);
 void host_set_driver(host_driver_t *d)
 {
     driver = d;
+    keyboard_leds_changed = true;
 }
 
 host_driver_t *host_get_driver(void)
@@ -58,10 +62,25 @@ uint8_t host_keyboard_leds(void)
     if (!driver) return 0;
     return (*driver->keyboard_leds)();
 }
+
+void host_keyboard_leds_changed(void)
+{
+    keyboard_leds_changed = true;
+}
+
+bool host_keyboard_leds_updated(void)
+{
+    if (!keyboard_leds_changed) return false;
+    // clear before LEDs are read so that change in the meantime is not lost
+    keyboard_leds_changed = false;
+    return true;
+}
 /* send report */
 void host_keyboard_send(report_keyboard_t *report)
 {
     if (!driver) return;
+    latency_mark(LATENCY_HOST_SEND);
+    trace_report(report);
     (*driver->send_keyboard)(report);
 
     if (debug_keyboard) {
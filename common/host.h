@@ -43,6 +43,10 @@ host_driver_t *host_get_driver(void);
 
 /* host driver interface */
 uint8_t host_keyboard_leds(void);
+/* called by protocol driver when host sets LEDs, can be in interrupt */
+void host_keyboard_leds_changed(void);
+/* true once after LEDs are changed */
+bool host_keyboard_leds_updated(void);
 void host_keyboard_send(report_keyboard_t *report);
 void host_mouse_send(report_mouse_t *report);
 void host_system_send(uint16_t data);
@@ -16,6 +16,13 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include <stdint.h>
 #include <util/delay.h>
+#if defined(MATRIX_SCAN_ISR) || defined(MATRIX_IDLE_SLEEP)
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#endif
+#ifdef MATRIX_IDLE_SLEEP
+#include <avr/sleep.h>
+#endif
 #include "keyboard.h"
 #include "matrix.h"
 #include "keymap.h"
@@ -32,19 +39,371 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "eeconfig.h"
 #include "mousekey.h"
 #include "backlight.h"
+#include "event_queue.h"
+#include "latency.h"
+#ifdef DEBOUNCE_ADAPTIVE
+#include "debounce.h"
+#endif
+
+
+static matrix_row_t matrix_prev[MATRIX_ROWS];
+// rows which can differ from matrix_prev
+static matrix_dirty_t matrix_dirty = 0;
+
+/* key event time stamp from timer_read_fine(): time should not be 0 */
+static inline uint16_t event_time(uint32_t t)
+{
+    uint16_t ms = TIMER_FINE_MS(t);
+    return (ms ? ms : 1);
+}
 
 
 #ifdef MATRIX_HAS_GHOST
-static bool has_ghost_in_row(uint8_t row)
+/*
+ * Ghost key analysis
+ *
+ * Ghost can occur on a key of row which has two or more keys down when its
+ * column line is also shared with other row. Number of rows down on each
+ * column is counted incrementally from changed bits and those ambiguous
+ * keys are masked until they become definite. Other keys are processed.
+ */
+static matrix_row_t ghost_raw[MATRIX_ROWS];     // rows counted in ghost_col_count
+static uint8_t ghost_col_count[MATRIX_COLS];
+static matrix_row_t ghost_cols = 0;             // columns down on two or more rows
+
+static void ghost_update(matrix_dirty_t dirty)
+{
+    for (uint8_t r = 0; dirty; r++, dirty >>= 1) {
+        if (!(dirty & 1)) continue;
+        matrix_row_t matrix_row = matrix_get_row(r);
+        matrix_row_t change = matrix_row ^ ghost_raw[r];
+        if (!change) continue;
+
+        ghost_raw[r] = matrix_row;
+        for (; change; change &= change - 1) {
+            uint8_t c = MATRIX_ROW_BITCTZ(change);
+            if (matrix_row & MATRIX_ROW_BIT(c)) {
+                if (++ghost_col_count[c] == 2) ghost_cols |= MATRIX_ROW_BIT(c);
+            } else {
+                if (--ghost_col_count[c] == 1) ghost_cols &= ~MATRIX_ROW_BIT(c);
+            }
+        }
+    }
+}
+
+static inline matrix_row_t ghost_mask(matrix_row_t matrix_row)
 {
-    matrix_row_t matrix_row = matrix_get_row(row);
     // No ghost exists when less than 2 keys are down on the row
-    if (((matrix_row - 1) & matrix_row) == 0)
+    if (MATRIX_ROW_SINGLE(matrix_row))
+        return 0;
+    return matrix_row & ghost_cols;
+}
+#endif
+
+/* changed keys on the row to be processed */
+static inline matrix_row_t matrix_row_change(uint8_t row, matrix_row_t matrix_row)
+{
+#ifdef MATRIX_HAS_GHOST
+    // ghost adds only false key down; ambiguous keys are left unchanged in matrix_prev
+    return (matrix_row ^ matrix_prev[row]) & ~ghost_mask(matrix_row);
+#else
+    return matrix_row ^ matrix_prev[row];
+#endif
+}
+
+/* rows marked by scanner since last matrix_dirty_update() */
+static matrix_dirty_t matrix_dirty_marked = 0;
+static bool matrix_dirty_tracked = false;
+
+void matrix_dirty_mark(matrix_dirty_t rows)
+{
+    matrix_dirty_marked |= rows;
+    matrix_dirty_tracked = true;
+}
+
+/* take changed rows from scanner after matrix_scan(); all rows of scanners
+ * which don't track changes */
+static inline void matrix_dirty_update(void)
+{
+    matrix_dirty_t dirty = MATRIX_DIRTY_ALL;
+    if (matrix_dirty_tracked) {
+        dirty = matrix_dirty_marked;
+        matrix_dirty_marked = 0;
+    }
+#ifdef MATRIX_HAS_GHOST
+    ghost_update(dirty);
+#endif
+    matrix_dirty |= dirty;
+}
+
+/* stop looking at the row once it is identical to matrix_prev */
+static inline void matrix_dirty_clear(uint8_t row, matrix_row_t matrix_row)
+{
+    if (matrix_row == matrix_prev[row])
+        matrix_dirty &= ~MATRIX_DIRTY_ROW(row);
+}
+
+
+#ifdef MATRIX_SCAN_ISR
+/*
+ * Fixed rate matrix scan on Timer3 compare match
+ *
+ * Scan runs in interrupt context and queues key events, keyboard_task() just
+ * consumes the queue. Debug print of scanner code is also called in interrupt.
+ */
+#ifndef MATRIX_SCAN_RATE
+#define MATRIX_SCAN_RATE    1000    // Hz
+#endif
+
+#if !defined(TIMSK3)
+#   error "MATRIX_SCAN_ISR requires Timer3"
+#endif
+
+/* prescaler 8 */
+#define SCAN_TIMER_TOP      ((F_CPU / 8 / MATRIX_SCAN_RATE) - 1)
+#if SCAN_TIMER_TOP > 0xFFFF || SCAN_TIMER_TOP < 1
+#   error "MATRIX_SCAN_RATE is out of range"
+#endif
+
+static void keyboard_scan_isr_init(void)
+{
+    TCCR3A = 0;
+    TCCR3B = _BV(WGM32) | _BV(CS31);   // CTC, clk/8
+    OCR3A = SCAN_TIMER_TOP;
+    TCNT3 = 0;
+    keyboard_scan_isr_enable();
+}
+
+void keyboard_scan_isr_enable(void)
+{
+    TIFR3 = _BV(OCF3A);
+    TIMSK3 |= _BV(OCIE3A);
+}
+
+void keyboard_scan_isr_disable(void)
+{
+    TIMSK3 &= ~_BV(OCIE3A);
+}
+
+static void matrix_scan_enqueue(void)
+{
+    matrix_row_t matrix_row = 0;
+    matrix_row_t matrix_change = 0;
+    uint32_t scan_time;
+
+    latency_scan_start();
+    matrix_scan();
+    latency_mark(LATENCY_SCAN);
+    matrix_dirty_update();
+    scan_time = timer_read_fine();
+    matrix_dirty_t dirty = matrix_dirty;
+    for (uint8_t r = 0; dirty; r++, dirty >>= 1) {
+        if (!(dirty & 1)) continue;
+        matrix_row = matrix_get_row(r);
+        matrix_change = matrix_row_change(r, matrix_row);
+        for (; matrix_change; matrix_change &= matrix_change - 1) {
+            uint8_t c = MATRIX_ROW_BITCTZ(matrix_change);
+            // when queue is full leave matrix_prev untouched to retry at next scan
+            if (!event_queue_enq((keyevent_t){
+                        .key = (key_t){ .row = r, .col = c },
+                        .pressed = (matrix_row & MATRIX_ROW_BIT(c)),
+                        .time = event_time(scan_time),
+                        .time_fine = TIMER_FINE_RAW(scan_time)
+                    })) {
+                return;
+            }
+            matrix_prev[r] ^= MATRIX_ROW_BIT(c);
+        }
+        matrix_dirty_clear(r, matrix_row);
+    }
+}
+
+ISR(TIMER3_COMPA_vect)
+{
+    // mask only itself and let USB interrupts preempt slow scan
+    TIMSK3 &= ~_BV(OCIE3A);
+    sei();
+    matrix_scan_enqueue();
+    cli();
+    TIMSK3 |= _BV(OCIE3A);
+}
+#endif
+
+#ifdef MATRIX_KEY_EVENT
+/*
+ * Key events pushed by converter
+ *
+ * Converter decodes make/break code into event queue in its arrival order
+ * and keeps matrix for bootmagic and suspend wakeup. matrix_prev follows
+ * dispatched events, then dirty row comparison finds nothing unless events
+ * are lost on queue full.
+ */
+#ifdef MATRIX_SCAN_ISR
+#   error "MATRIX_KEY_EVENT can't be used with MATRIX_SCAN_ISR"
+#endif
+
+void matrix_key_event(uint8_t row, uint8_t col, bool pressed, uint32_t time)
+{
+    event_queue_enq((keyevent_t){
+        .key = (key_t){ .row = row, .col = col },
+        .pressed = pressed,
+        .time = event_time(time),
+        .time_fine = TIMER_FINE_RAW(time)
+    });
+}
+
+static bool matrix_key_event_dispatch(void)
+{
+    keyevent_t event;
+    bool dispatched = false;
+
+    while (event_queue_deq(&event)) {
+        if (debug_matrix && !dispatched) matrix_print();
+        action_exec(event);
+        if (event.pressed)
+            matrix_prev[event.key.row] |=  MATRIX_ROW_BIT(event.key.col);
+        else
+            matrix_prev[event.key.row] &= ~MATRIX_ROW_BIT(event.key.col);
+        dispatched = true;
+#ifndef KEYBOARD_BATCH_DISPATCH
+        // process a key per task call
+        break;
+#endif
+    }
+    return dispatched;
+}
+#endif
+
+#ifdef MATRIX_ROW_COMMIT
+/*
+ * Row commit
+ *
+ * Scanner calls matrix_row_commit() as soon as debounce changes a row in
+ * matrix_scan(), and keys of the row are processed before rest of matrix is
+ * read. All changes of the row are processed at once. Changes left on queue
+ * full are found by dirty row comparison after the scan.
+ */
+#ifdef MATRIX_HAS_GHOST
+#   error "MATRIX_ROW_COMMIT can't be used with MATRIX_HAS_GHOST: ghost needs whole matrix"
+#endif
+#ifdef MATRIX_KEY_EVENT
+#   error "MATRIX_ROW_COMMIT can't be used with MATRIX_KEY_EVENT"
+#endif
+
+#ifndef MATRIX_SCAN_ISR
+// matrix is printed after the scan, not between rows
+static bool row_committed = false;
+#endif
+
+void matrix_row_commit(uint8_t row)
+{
+    matrix_row_t matrix_row = matrix_get_row(row);
+    matrix_row_t matrix_change = matrix_row ^ matrix_prev[row];
+    if (!matrix_change) return;
+
+    uint32_t time = timer_read_fine();
+#ifndef MATRIX_SCAN_ISR
+    row_committed = true;
+#endif
+    for (; matrix_change; matrix_change &= matrix_change - 1) {
+        uint8_t c = MATRIX_ROW_BITCTZ(matrix_change);
+        keyevent_t event = {
+            .key = (key_t){ .row = row, .col = c },
+            .pressed = (matrix_row & MATRIX_ROW_BIT(c)),
+            .time = event_time(time),
+            .time_fine = TIMER_FINE_RAW(time)
+        };
+#ifdef MATRIX_SCAN_ISR
+        // in interrupt: queue for keyboard_task()
+        if (!event_queue_enq(event)) return;
+#else
+        action_exec(event);
+#endif
+        matrix_prev[row] ^= MATRIX_ROW_BIT(c);
+    }
+}
+#endif
+
+#ifdef MATRIX_IDLE_SLEEP
+/*
+ * Idle sleep
+ *
+ * When no key is on scanner selects all rows and key edge on its input lines
+ * of PORTB is watched with pin change interrupt instead of scanning. CPU
+ * sleeps until next interrupt, timer tick in 1ms at longest, and the edge
+ * resumes scanning at once.
+ */
+#if defined(MATRIX_SCAN_ISR) || defined(MATRIX_KEY_EVENT)
+#   error "MATRIX_IDLE_SLEEP can't be used with MATRIX_SCAN_ISR or MATRIX_KEY_EVENT"
+#endif
+
+// lines are selected for wake
+static bool idle = false;
+// pin change interrupt is armed, cleared on key edge
+static volatile bool idle_armed = false;
+
+ISR(PCINT0_vect)
+{
+    PCICR &= ~_BV(PCIE0);
+    idle_armed = false;
+}
+
+static bool keyboard_idle_enter(void)
+{
+    // all keys are off and processed
+    if (matrix_dirty) return false;
+    for (uint8_t r = 0; r < MATRIX_ROWS; r++) {
+        if (matrix_prev[r]) return false;
+    }
+
+    uint8_t pins = matrix_idle_enter();
+    if (!pins) return false;
+
+    PCMSK0 = pins;
+    PCIFR = _BV(PCIF0);
+    // key pressed before flag was cleared
+    if ((PINB & pins) != pins) {
+        PCMSK0 = 0;
+        matrix_idle_exit();
         return false;
+    }
+    idle_armed = true;
+    PCICR |= _BV(PCIE0);
+    return true;
+}
+
+void keyboard_idle_exit(void)
+{
+    if (!idle) return;
+    PCICR &= ~_BV(PCIE0);
+    PCMSK0 = 0;
+    idle_armed = false;
+    matrix_idle_exit();
+    idle = false;
+}
+
+static void keyboard_idle_sleep(void)
+{
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    cli();
+    if (idle_armed) {
+        sleep_enable();
+        // sleep instruction runs before pending interrupt
+        sei();
+        sleep_cpu();
+        sleep_disable();
+    }
+    sei();
+}
+#endif
 
-    // Ghost occurs when the row shares column line with other row
-    for (uint8_t i=0; i < MATRIX_ROWS; i++) {
-        if (i != row && (matrix_get_row(i) & matrix_row))
+#if !defined(MATRIX_SCAN_ISR) && !defined(KEYBOARD_BATCH_DISPATCH)
+/* any key change left from row */
+static bool matrix_has_change(uint8_t row)
+{
+    matrix_dirty_t dirty = matrix_dirty >> row;
+    for (uint8_t r = row; dirty; r++, dirty >>= 1) {
+        if ((dirty & 1) && matrix_row_change(r, matrix_get_row(r)))
             return true;
     }
     return false;
@@ -70,6 +429,10 @@ void keyboard_init(void)
 #ifdef BACKLIGHT_ENABLE
     backlight_init();
 #endif
+
+#ifdef MATRIX_SCAN_ISR
+    keyboard_scan_isr_init();
+#endif
 }
 
 /*
@@ -78,38 +441,101 @@ void keyboard_init(void)
  */
 void keyboard_task(void)
 {
-    static matrix_row_t matrix_prev[MATRIX_ROWS];
-    static uint8_t led_status = 0;
+#ifdef MATRIX_SCAN_ISR
+    keyevent_t event;
+
+    if (event_queue_deq(&event)) {
+        if (debug_matrix) matrix_print();
+        action_exec(event);
+#ifdef KEYBOARD_BATCH_DISPATCH
+        while (event_queue_deq(&event)) {
+            action_exec(event);
+        }
+#endif
+        goto MATRIX_LOOP_END;
+    }
+#else
+    static uint32_t scan_time = 0;
     matrix_row_t matrix_row = 0;
     matrix_row_t matrix_change = 0;
+#ifdef KEYBOARD_BATCH_DISPATCH
+    bool dispatched = false;
+#else
+    // changes detected by earlier scan are still waiting for dispatch
+    static bool scan_pending = false;
+#endif
 
-    matrix_scan();
-    for (uint8_t r = 0; r < MATRIX_ROWS; r++) {
+#ifdef MATRIX_IDLE_SLEEP
+    if (idle) {
+        // no scan until key edge
+        if (idle_armed) goto MATRIX_IDLE;
+        keyboard_idle_exit();
+    }
+#endif
+#ifdef MATRIX_KEY_EVENT
+    // scan again after all events of last scan are dispatched
+    if (event_queue_is_empty())
+#endif
+    {
+        latency_scan_start();
+        matrix_scan();
+        latency_mark(LATENCY_SCAN);
+        matrix_dirty_update();
+#ifdef MATRIX_ROW_COMMIT
+        if (row_committed) {
+            row_committed = false;
+            if (debug_matrix) matrix_print();
+        }
+#endif
+    }
+#ifdef MATRIX_KEY_EVENT
+    if (matrix_key_event_dispatch()) goto MATRIX_LOOP_END;
+#endif
+#ifndef KEYBOARD_BATCH_DISPATCH
+    if (!scan_pending)
+#endif
+        scan_time = timer_read_fine();
+    // only rows reported by scanner or left unprocessed
+    matrix_dirty_t dirty = matrix_dirty;
+    for (uint8_t r = 0; dirty; r++, dirty >>= 1) {
+        if (!(dirty & 1)) continue;
         matrix_row = matrix_get_row(r);
-        matrix_change = matrix_row ^ matrix_prev[r];
+        matrix_change = matrix_row_change(r, matrix_row);
         if (matrix_change) {
             if (debug_matrix) matrix_print();
-#ifdef MATRIX_HAS_GHOST
-            if (has_ghost_in_row(r)) {
-                matrix_prev[r] = matrix_row;
-                continue;
-            }
+            for (; matrix_change; matrix_change &= matrix_change - 1) {
+                uint8_t c = MATRIX_ROW_BITCTZ(matrix_change);
+                action_exec((keyevent_t){
+                    .key = (key_t){ .row = r, .col = c },
+                    .pressed = (matrix_row & MATRIX_ROW_BIT(c)),
+                    .time = event_time(scan_time),
+                    .time_fine = TIMER_FINE_RAW(scan_time)
+                });
+                // record a processed key
+                matrix_prev[r] ^= MATRIX_ROW_BIT(c);
+#ifdef KEYBOARD_BATCH_DISPATCH
+                // process all changes of this scan in row/col order
+                dispatched = true;
+#else
+                matrix_dirty_clear(r, matrix_row);
+                // keep time stamp of this scan for keys left
+                scan_pending = matrix_has_change(r);
+                // process a key per task call
+                goto MATRIX_LOOP_END;
 #endif
-            for (uint8_t c = 0; c < MATRIX_COLS; c++) {
-                if (matrix_change & ((matrix_row_t)1<<c)) {
-                    action_exec((keyevent_t){
-                        .key = (key_t){ .row = r, .col = c },
-                        .pressed = (matrix_row & ((matrix_row_t)1<<c)),
-                        .time = (timer_read() | 1) /* time should not be 0 */
-                    });
-                    // record a processed key
-                    matrix_prev[r] ^= ((matrix_row_t)1<<c);
-                    // process a key per task call
-                    goto MATRIX_LOOP_END;
-                }
             }
         }
+        matrix_dirty_clear(r, matrix_row);
     }
+#ifdef KEYBOARD_BATCH_DISPATCH
+    if (dispatched) goto MATRIX_LOOP_END;
+#else
+    scan_pending = false;
+#endif
+#endif
+#ifdef MATRIX_IDLE_SLEEP
+MATRIX_IDLE:
+#endif
     // call with pseudo tick event when no real key event.
     action_exec(TICK);
 
@@ -118,11 +544,19 @@ MATRIX_LOOP_END:
     // mousekey repeat & acceleration
     mousekey_task();
 #endif
-    // update LED
-    if (led_status != host_keyboard_leds()) {
-        led_status = host_keyboard_leds();
-        keyboard_set_leds(led_status);
+    // update LED only when host changed it
+    if (host_keyboard_leds_updated()) {
+        keyboard_set_leds(host_keyboard_leds());
     }
+#if defined(DEBOUNCE_ADAPTIVE) && defined(BOOTMAGIC_ENABLE)
+    // learned debounce counts, not while keys are bouncing
+    if (debounce_idle()) debounce_save();
+#endif
+
+#ifdef MATRIX_IDLE_SLEEP
+    if (!idle) idle = keyboard_idle_enter();
+    if (idle) keyboard_idle_sleep();
+#endif
 }
 
 void keyboard_set_leds(uint8_t leds)
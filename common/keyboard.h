@@ -32,11 +32,15 @@ typedef struct {
     uint8_t row;
 } key_t;
 
-/* key event */
+/* key event
+ * time:      ms when matrix scan detected the change
+ * time_fine: Timer0 count in the ms(TIMER_RAW_TOP+1 counts per ms)
+ */
 typedef struct {
     key_t    key;
     bool     pressed;
     uint16_t time;
+    uint8_t  time_fine;
 } keyevent_t;
 
 /* equivalent test of key_t */
@@ -62,6 +66,14 @@ typedef struct {
 void keyboard_init(void);
 void keyboard_task(void);
 void keyboard_set_leds(uint8_t leds);
+#ifdef MATRIX_SCAN_ISR
+void keyboard_scan_isr_enable(void);
+void keyboard_scan_isr_disable(void);
+#endif
+#ifdef MATRIX_IDLE_SLEEP
+/* resume matrix scan from idle sleep */
+void keyboard_idle_exit(void);
+#endif
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,125 @@
+/*
+Copyright 2013 Jun Wako <wakojun@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "keyboard.h"
+#include "timer.h"
+#include "print.h"
+#include "util.h"
+#include "latency.h"
+
+
+#define LATENCY_BUCKETS     16
+#define TICKS_PER_MS        (TIMER_RAW_TOP + 1)
+
+typedef struct {
+    uint16_t count;
+    uint16_t min;
+    uint16_t max;
+    uint32_t sum;
+    uint16_t hist[LATENCY_BUCKETS];  // log2 of count: [0], [1], [2-3], [4-7]...
+} latency_stat_t;
+
+static latency_stat_t stats[LATENCY_STAGES];
+static uint32_t scan_origin;
+static uint32_t event_origin;
+static bool event_pending = false;  // report of the event is not sent yet
+
+static const char stage_name[LATENCY_STAGES][9] PROGMEM = {
+    "scan", "debounce", "action", "host", "usb"
+};
+
+
+/* Timer0 count between two timer_read_fine() values, saturated to 16bit */
+static uint16_t elapsed_ticks(uint32_t from, uint32_t to)
+{
+    uint16_t ms = TIMER_FINE_MS(to) - TIMER_FINE_MS(from);
+    if (ms >= UINT16_MAX / TICKS_PER_MS) return UINT16_MAX;
+    return ms * TICKS_PER_MS + TIMER_FINE_RAW(to) - TIMER_FINE_RAW(from);
+}
+
+static void record(uint8_t stage, uint16_t ticks)
+{
+    latency_stat_t *s = &stats[stage];
+
+    if (s->count == UINT16_MAX) return;
+    if (s->count == 0 || ticks < s->min) s->min = ticks;
+    if (ticks > s->max) s->max = ticks;
+    s->sum += ticks;
+    s->count++;
+
+    uint8_t b = ticks ? biton16(ticks) + 1 : 0;
+    if (b >= LATENCY_BUCKETS) b = LATENCY_BUCKETS - 1;
+    if (s->hist[b] != UINT16_MAX) s->hist[b]++;
+}
+
+void latency_scan_start(void)
+{
+    scan_origin = timer_read_fine();
+}
+
+/* origin of later stages: time stamp of the event */
+void latency_event(keyevent_t event)
+{
+    event_origin = (uint32_t)event.time << 8 | event.time_fine;
+    event_pending = true;
+}
+
+void latency_mark(uint8_t stage)
+{
+    uint32_t now = timer_read_fine();
+
+    if (stage <= LATENCY_DEBOUNCE) {
+        record(stage, elapsed_ticks(scan_origin, now));
+    } else if (event_pending) {
+        // reports by timeout, mousekey or clear are not counted
+        record(stage, elapsed_ticks(event_origin, now));
+        if (stage == LATENCY_USB_SENT) event_pending = false;
+    }
+}
+
+void latency_clear(void)
+{
+    uint8_t sreg = SREG;
+    cli();
+    for (uint8_t i = 0; i < LATENCY_STAGES; i++) {
+        stats[i] = (latency_stat_t){};
+    }
+    SREG = sreg;
+}
+
+void latency_print(void)
+{
+    xprintf("\n----- Latency(unit: 1/%luHz) -----\n", (uint32_t)TIMER_RAW_FREQ);
+    for (uint8_t i = 0; i < LATENCY_STAGES; i++) {
+        latency_stat_t *s = &stats[i];
+        print_P(stage_name[i]);
+        if (s->count == 0) {
+            print(": -\n");
+            continue;
+        }
+        xprintf(": n=%u min=%u max=%u mean=%lu\n",
+                s->count, s->min, s->max, s->sum / s->count);
+        print(" log2:");
+        for (uint8_t b = 0; b < LATENCY_BUCKETS; b++) {
+            xprintf(" %u", s->hist[b]);
+        }
+        print("\n");
+    }
+}
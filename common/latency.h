@@ -0,0 +1,60 @@
+/*
+Copyright 2013 Jun Wako <wakojun@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdint.h>
+#include "keyboard.h"
+
+
+/* Pipeline latency trace
+ *
+ * Scan stages are measured from start of matrix_scan() and the others from
+ * time stamp of key event which is taken at end of the scan. Host and usb
+ * stages count only the first report after a key event, until protocol marks
+ * LATENCY_USB_SENT(lufa, pjrc).
+ * Unit is Timer0 count(TIMER_RAW_FREQ).
+ */
+enum latency_stage {
+    LATENCY_SCAN = 0,       // matrix_scan() end
+    LATENCY_DEBOUNCE,       // debounced matrix is updated
+    LATENCY_ACTION,         // action_exec() entry
+    LATENCY_HOST_SEND,      // host_keyboard_send()
+    LATENCY_USB_SENT,       // keyboard report is written to endpoint
+    LATENCY_STAGES
+};
+
+
+#ifdef LATENCY_TRACE_ENABLE
+
+void latency_scan_start(void);
+void latency_event(keyevent_t event);
+void latency_mark(uint8_t stage);
+void latency_print(void);
+void latency_clear(void);
+
+#else
+
+#define latency_scan_start()
+#define latency_event(event)
+#define latency_mark(stage)
+#define latency_print()
+#define latency_clear()
+
+#endif
+
+#endif
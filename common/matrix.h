@@ -20,19 +20,52 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "util.h"
 
 
+/* row width is chosen by number of columns; 8-column boards use 8-bit rows */
 #if (MATRIX_COLS <= 8)
 typedef  uint8_t    matrix_row_t;
+#   define MATRIX_ROW_BITPOP(bits)  bitpop(bits)
+#   define MATRIX_ROW_BITCTZ(bits)  bitctz(bits)
+#   define MATRIX_ROW_PRINT(bits)   print_bin_reverse8(bits)
+#   define MATRIX_ROW_HEADER        "r/c 01234567"
 #elif (MATRIX_COLS <= 16)
 typedef  uint16_t   matrix_row_t;
+#   define MATRIX_ROW_BITPOP(bits)  bitpop16(bits)
+#   define MATRIX_ROW_BITCTZ(bits)  bitctz16(bits)
+#   define MATRIX_ROW_PRINT(bits)   print_bin_reverse16(bits)
+#   define MATRIX_ROW_HEADER        "r/c 0123456789ABCDEF"
 #elif (MATRIX_COLS <= 32)
 typedef  uint32_t   matrix_row_t;
+#   define MATRIX_ROW_BITPOP(bits)  bitpop32(bits)
+#   define MATRIX_ROW_BITCTZ(bits)  bitctz32(bits)
+#   define MATRIX_ROW_PRINT(bits)   print_bin_reverse32(bits)
+#   define MATRIX_ROW_HEADER        "r/c 0123456789ABCDEF0123456789ABCDEF"
 #else
 #error "MATRIX_COLS: invalid value"
 #endif
 
-#define MATRIX_IS_ON(row, col)  (matrix_get_row(row) && (1<<col))
+/* iterate on-bits: col = MATRIX_ROW_BITCTZ(bits); bits &= bits - 1; */
+#define MATRIX_ROW_BIT(col)     ((matrix_row_t)1<<(col))
+/* no or only one key is on */
+#define MATRIX_ROW_SINGLE(bits) ((matrix_row_t)((bits) & ((bits) - 1)) == 0)
+
+/* bitmap of rows */
+#if (MATRIX_ROWS <= 8)
+typedef  uint8_t    matrix_dirty_t;
+#elif (MATRIX_ROWS <= 16)
+typedef  uint16_t   matrix_dirty_t;
+#elif (MATRIX_ROWS <= 32)
+typedef  uint32_t   matrix_dirty_t;
+#else
+#error "MATRIX_ROWS: invalid value"
+#endif
+
+#define MATRIX_DIRTY_ROW(row)   ((matrix_dirty_t)1<<(row))
+#define MATRIX_DIRTY_ALL        ((MATRIX_DIRTY_ROW(MATRIX_ROWS - 1)<<1) - 1)
+
+#define MATRIX_IS_ON(row, col)  (matrix_get_row(row) & MATRIX_ROW_BIT(col))
 
 
 /* number of matrix rows */
@@ -49,6 +82,28 @@ bool matrix_is_modified(void) __attribute__ ((deprecated));
 bool matrix_is_on(uint8_t row, uint8_t col);
 /* matrix state on row */
 matrix_row_t  matrix_get_row(uint8_t row);
+/* mark rows which can have changed. optional: once scanner marks MATRIX_DIRTY_ALL
+ * in matrix_init() only marked rows are compared after matrix_scan, otherwise all rows */
+void matrix_dirty_mark(matrix_dirty_t rows);
+#ifdef MATRIX_KEY_EVENT
+/* converter pushes key event decoded in matrix_scan(). time: timer_read_fine() */
+void matrix_key_event(uint8_t row, uint8_t col, bool pressed, uint32_t time);
+#else
+#define matrix_key_event(row, col, pressed, time)
+#endif
+#ifdef MATRIX_IDLE_SLEEP
+/* select all rows to wake on key edge when all keys are off and settled.
+ * returns input pins of PORTB to watch, active low, or 0 not to sleep */
+uint8_t matrix_idle_enter(void);
+/* unselect rows to resume matrix_scan() */
+void matrix_idle_exit(void);
+#endif
+#ifdef MATRIX_ROW_COMMIT
+/* scanner calls when debounce changed the row in matrix_scan() */
+void matrix_row_commit(uint8_t row);
+#else
+#define matrix_row_commit(row)
+#endif
 /* print matrix for debug */
 void matrix_print(void);
 
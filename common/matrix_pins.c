@@ -0,0 +1,303 @@
+/*
+Copyright 2013 Jun Wako <wakojun@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * scan matrix declared with pin tables in config.h
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <avr/io.h>
+#include <util/delay.h>
+#include "print.h"
+#include "debug.h"
+#include "util.h"
+#include "matrix.h"
+#include "matrix_pins.h"
+#include "debounce.h"
+#include "matrix_settle.h"
+
+
+#if !defined(MATRIX_ROW_PINS) || !defined(MATRIX_COL_PINS)
+#   error "MATRIX_ROW_PINS and MATRIX_COL_PINS are required in config.h"
+#endif
+
+/* tables are padded to 32 so that unrolled code below can index them safely */
+static const uint8_t row_pins[32] = MATRIX_ROW_PINS;
+static const uint8_t col_pins[32] = MATRIX_COL_PINS;
+
+/* tables must have MATRIX_ROWS and MATRIX_COLS pins */
+typedef char matrix_row_pins_check[(sizeof((uint8_t[])MATRIX_ROW_PINS) == MATRIX_ROWS) ? 1 : -1];
+typedef char matrix_col_pins_check[(sizeof((uint8_t[])MATRIX_COL_PINS) == MATRIX_COLS) ? 1 : -1];
+
+/* PINx, DDRx and PORTx of port n are at I/O address 3n, 3n+1 and 3n+2 */
+#define PIN_PORT(pin)   ((pin) >> 3)
+#define PIN_BIT(pin)    ((pin) & 7)
+#define PIN_REG(port)   _SFR_IO8(3 * (port))
+#define DDR_REG(port)   _SFR_IO8(3 * (port) + 1)
+#define PORT_REG(port)  _SFR_IO8(3 * (port) + 2)
+
+#define ROW_PORT(r)     PIN_PORT(row_pins[r])
+#define ROW_BIT(r)      PIN_BIT(row_pins[r])
+#define COL_PORT(c)     PIN_PORT(col_pins[c])
+#define COL_BIT(c)      PIN_BIT(col_pins[c])
+/* column is at its pin bit in a byte of row */
+#define COL_ALIGNED(c)  ((c) >= COL_BIT(c) && ((c) - COL_BIT(c)) % 8 == 0)
+
+/* index clamped in unrolled code so that dead branches don't overflow shift or array */
+#define ROW(r)          ((r) < MATRIX_ROWS ? (r) : 0)
+#define COL(c)          ((c) < MATRIX_COLS ? (c) : 0)
+
+#define REPEAT32(M) \
+    M(0)  M(1)  M(2)  M(3)  M(4)  M(5)  M(6)  M(7)  \
+    M(8)  M(9)  M(10) M(11) M(12) M(13) M(14) M(15) \
+    M(16) M(17) M(18) M(19) M(20) M(21) M(22) M(23) \
+    M(24) M(25) M(26) M(27) M(28) M(29) M(30) M(31)
+#define REPEAT_PORTS(M) M(0) M(1) M(2) M(3) M(4) M(5)
+
+
+/* matrix state(1:on, 0:off) */
+static matrix_row_t matrix[MATRIX_ROWS];
+
+static void init_cols(void);
+static matrix_row_t read_cols(void);
+static void unselect_rows(void);
+#ifdef MATRIX_SETTLE_CALIBRATE
+static void drive_cols(void);
+static bool cols_active(void);
+#endif
+
+
+/* pin bits of rows on the port */
+static inline uint8_t row_mask(uint8_t port)
+{
+#define ROW_MASK(r) | (((r) < MATRIX_ROWS && ROW_PORT(r) == port) ? (1<<ROW_BIT(r)) : 0)
+    return 0 REPEAT32(ROW_MASK);
+#undef ROW_MASK
+}
+
+/* pin bits of columns on the port */
+static inline uint8_t col_mask(uint8_t port)
+{
+#define COL_MASK(c) | (((c) < MATRIX_COLS && COL_PORT(c) == port) ? (1<<COL_BIT(c)) : 0)
+    return 0 REPEAT32(COL_MASK);
+#undef COL_MASK
+}
+
+/* pin bits of columns on the port which are in byte n of row at the same bit */
+static inline uint8_t col_aligned_mask(uint8_t port, uint8_t n)
+{
+#define COL_ALIGNED_MASK(c) | (((c) < MATRIX_COLS && COL_PORT(c) == port && COL_ALIGNED(c) && (c) / 8 == n) ? (1<<COL_BIT(c)) : 0)
+    return 0 REPEAT32(COL_ALIGNED_MASK);
+#undef COL_ALIGNED_MASK
+}
+
+
+inline
+uint8_t matrix_rows(void)
+{
+    return MATRIX_ROWS;
+}
+
+inline
+uint8_t matrix_cols(void)
+{
+    return MATRIX_COLS;
+}
+
+void matrix_init(void)
+{
+    // initialize row and col
+    unselect_rows();
+    init_cols();
+#ifdef MATRIX_SETTLE_CALIBRATE
+    matrix_settle_calibrate(drive_cols, init_cols, cols_active);
+#endif
+
+    // initialize matrix state: all keys off
+    for (uint8_t i=0; i < MATRIX_ROWS; i++) {
+        matrix[i] = 0;
+    }
+    matrix_dirty_mark(MATRIX_DIRTY_ALL);
+    debounce_init();
+}
+
+uint8_t matrix_scan(void)
+{
+    // Output low(DDR:1, PORT:0) to select, PORT is kept 0
+#define SCAN_ROW(r) \
+    if ((r) < MATRIX_ROWS) { \
+        DDR_REG(ROW_PORT(r)) |= (1<<ROW_BIT(r)); \
+        matrix_settle_wait(); \
+        bool changed = debounce_row(r, read_cols(), &matrix[ROW(r)]); \
+        DDR_REG(ROW_PORT(r)) &= ~(1<<ROW_BIT(r)); \
+        if (changed) { \
+            matrix_dirty_mark(MATRIX_DIRTY_ROW(ROW(r))); \
+            matrix_row_commit(ROW(r)); \
+        } \
+    }
+    REPEAT32(SCAN_ROW);
+#undef SCAN_ROW
+
+    return 1;
+}
+
+bool matrix_is_modified(void)
+{
+    return true;
+}
+
+inline
+bool matrix_is_on(uint8_t row, uint8_t col)
+{
+    return (matrix[row] & MATRIX_ROW_BIT(col));
+}
+
+inline
+matrix_row_t matrix_get_row(uint8_t row)
+{
+    return matrix[row];
+}
+
+void matrix_print(void)
+{
+    print("\n" MATRIX_ROW_HEADER "\n");
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        phex(row); print(": ");
+        MATRIX_ROW_PRINT(matrix_get_row(row));
+        print("\n");
+    }
+}
+
+uint8_t matrix_key_count(void)
+{
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
+        count += MATRIX_ROW_BITPOP(matrix[i]);
+    }
+    return count;
+}
+
+#ifdef MATRIX_IDLE_SLEEP
+uint8_t matrix_idle_enter(void)
+{
+    // only columns on PORTB have pin change interrupt
+    if (col_mask(MATRIX_PORT_A) | col_mask(MATRIX_PORT_C) | col_mask(MATRIX_PORT_D) |
+        col_mask(MATRIX_PORT_E) | col_mask(MATRIX_PORT_F)) {
+        return 0;
+    }
+    if (!debounce_idle()) return 0;
+    for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
+        if (matrix[i]) return 0;
+    }
+
+    // select all rows
+#define SELECT_ROWS(p) \
+    if (row_mask(p)) { \
+        DDR_REG(p) |= row_mask(p); \
+    }
+    REPEAT_PORTS(SELECT_ROWS);
+#undef SELECT_ROWS
+    matrix_settle_wait();
+    return col_mask(MATRIX_PORT_B);
+}
+
+void matrix_idle_exit(void)
+{
+    unselect_rows();
+}
+#endif
+
+static void init_cols(void)
+{
+    // Input with pull-up(DDR:0, PORT:1)
+#define INIT_COLS(p) \
+    if (col_mask(p)) { \
+        DDR_REG(p)  &= ~col_mask(p); \
+        PORT_REG(p) |=  col_mask(p); \
+    }
+    REPEAT_PORTS(INIT_COLS);
+#undef INIT_COLS
+}
+
+#ifdef MATRIX_SETTLE_CALIBRATE
+static void drive_cols(void)
+{
+    // Output low(DDR:1, PORT:0)
+#define DRIVE_COLS(p) \
+    if (col_mask(p)) { \
+        PORT_REG(p) &= ~col_mask(p); \
+        DDR_REG(p)  |=  col_mask(p); \
+    }
+    REPEAT_PORTS(DRIVE_COLS);
+#undef DRIVE_COLS
+}
+
+static bool cols_active(void)
+{
+    return read_cols();
+}
+#endif
+
+static matrix_row_t read_cols(void)
+{
+    matrix_row_t cols = 0;
+    uint8_t pins[6] = { 0 };
+
+    // read each port once and take aligned columns with a mask
+#define READ_PORT(p) \
+    if (col_mask(p)) { \
+        pins[p] = ~PIN_REG(p); \
+        cols |= (matrix_row_t)(pins[p] & col_aligned_mask(p, 0)); \
+        READ_PORT_HIGH(p) \
+    }
+#if (MATRIX_COLS > 16)
+#   define READ_PORT_HIGH(p) \
+        cols |= (matrix_row_t)(pins[p] & col_aligned_mask(p, 1)) << 8; \
+        cols |= (matrix_row_t)(pins[p] & col_aligned_mask(p, 2)) << 16; \
+        cols |= (matrix_row_t)(pins[p] & col_aligned_mask(p, 3)) << 24;
+#elif (MATRIX_COLS > 8)
+#   define READ_PORT_HIGH(p) \
+        cols |= (matrix_row_t)(pins[p] & col_aligned_mask(p, 1)) << 8;
+#else
+#   define READ_PORT_HIGH(p)
+#endif
+    REPEAT_PORTS(READ_PORT);
+#undef READ_PORT
+#undef READ_PORT_HIGH
+
+    // and others bit by bit
+#define READ_COL(c) \
+    if ((c) < MATRIX_COLS && !COL_ALIGNED(c) && (pins[COL_PORT(c)] & (1<<COL_BIT(c)))) { \
+        cols |= MATRIX_ROW_BIT(COL(c)); \
+    }
+    REPEAT32(READ_COL);
+#undef READ_COL
+
+    return cols;
+}
+
+static void unselect_rows(void)
+{
+    // Hi-Z(DDR:0, PORT:0) to unselect
+#define UNSELECT_ROWS(p) \
+    if (row_mask(p)) { \
+        DDR_REG(p)  &= ~row_mask(p); \
+        PORT_REG(p) &= ~row_mask(p); \
+    }
+    REPEAT_PORTS(UNSELECT_ROWS);
+#undef UNSELECT_ROWS
+}
@@ -0,0 +1,44 @@
+/*
+Copyright 2013 Jun Wako <wakojun@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MATRIX_PINS_H
+#define MATRIX_PINS_H
+
+
+/* Generic matrix driver
+ *
+ * Board which has diodes from column to row declares pins in config.h
+ * instead of writing matrix.c, and adds common/matrix_pins.c to SRC.
+ *
+ *   #define MATRIX_ROW_PINS { MATRIX_PIN(D, 0), MATRIX_PIN(D, 1), ... }
+ *   #define MATRIX_COL_PINS { MATRIX_PIN(F, 0), MATRIX_PIN(F, 1), ... }
+ *
+ * Row is selected with output low and columns are read with pull-up.
+ * Pin tables are resolved at compile time: each port used by columns is read
+ * once per row and columns which keep their bit position in a byte are masked
+ * out together.
+ */
+#define MATRIX_PORT_A   0
+#define MATRIX_PORT_B   1
+#define MATRIX_PORT_C   2
+#define MATRIX_PORT_D   3
+#define MATRIX_PORT_E   4
+#define MATRIX_PORT_F   5
+
+#define MATRIX_PIN(port, bit)   ((MATRIX_PORT_##port << 3) | (bit))
+
+#endif
@@ -0,0 +1,97 @@
+/*
+Copyright 2013 Jun Wako <wakojun@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <util/delay.h>
+#include "print.h"
+#include "debug.h"
+#include "eeconfig.h"
+#include "matrix_settle.h"
+
+
+#if MATRIX_SETTLE_US > 254
+#   error "MATRIX_SETTLE_US must be less than 255"
+#endif
+
+/* measured this many times and the longest is taken */
+#define CALIBRATE_COUNT 16
+
+uint16_t matrix_settle_loops = MATRIX_SETTLE_LOOPS(MATRIX_SETTLE_US);
+static uint8_t settle_us = MATRIX_SETTLE_US;
+
+static void settle_set(uint8_t us)
+{
+    settle_us = us;
+    // _delay_loop_2(0) runs 65536 loops
+    matrix_settle_loops = us ? MATRIX_SETTLE_LOOPS(us) : 1;
+}
+
+/* time in us until lines read off, MATRIX_SETTLE_US+1 on timeout */
+static uint8_t recovery_time(void (*drive_lines)(void), void (*release_lines)(void), bool (*lines_active)(void))
+{
+    drive_lines();
+    _delay_us(10);
+    release_lines();
+
+    // each poll takes 1us and more, so this doesn't underestimate
+    uint8_t us = 0;
+    while (lines_active()) {
+        if (++us > MATRIX_SETTLE_US) break;
+        _delay_us(1);
+    }
+    return us;
+}
+
+void matrix_settle_calibrate(void (*drive_lines)(void), void (*release_lines)(void), bool (*lines_active)(void))
+{
+#ifdef BOOTMAGIC_ENABLE
+    if (eeconfig_is_enabled()) {
+        uint8_t saved = eeconfig_read_matrix_settle();
+        if (saved && saved <= MATRIX_SETTLE_US) {
+            settle_set(saved);
+            return;
+        }
+    }
+#endif
+
+    uint8_t max = 0;
+    for (uint8_t i = 0; i < CALIBRATE_COUNT; i++) {
+        uint8_t us = recovery_time(drive_lines, release_lines, lines_active);
+        if (us > max) max = us;
+    }
+    if (max > MATRIX_SETTLE_US) {
+        // line stuck low: keep default and measure again next time
+        debug("settle: timeout\n");
+        return;
+    }
+
+    // margin: twice and 1us
+    uint16_t us = max * 2 + 1;
+    settle_set(us < MATRIX_SETTLE_US ? us : MATRIX_SETTLE_US);
+    debug("settle: "); debug_dec(settle_us); debug("us\n");
+#ifdef BOOTMAGIC_ENABLE
+    if (eeconfig_is_enabled()) {
+        eeconfig_write_matrix_settle(settle_us);
+    }
+#endif
+}
+
+uint8_t matrix_settle_us(void)
+{
+    return settle_us;
+}
@@ -0,0 +1,59 @@
+/*
+Copyright 2013 Jun Wako <wakojun@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MATRIX_SETTLE_H
+#define MATRIX_SETTLE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <util/delay.h>
+#include <util/delay_basic.h>
+
+
+/* Row settle time
+ *
+ * Scanner calls matrix_settle_wait() after selecting a row so that input
+ * lines driven by keys on previous row recover before reading. It waits
+ * MATRIX_SETTLE_US by default.
+ *
+ * With MATRIX_SETTLE_CALIBRATE scanner calls matrix_settle_calibrate() in
+ * matrix_init(). It measures recovery time of the lines and waits twice of
+ * it, MATRIX_SETTLE_US at most. The result is saved in EEPROM with
+ * BOOTMAGIC_ENABLE and measured again after EEPROM is cleared.
+ */
+#ifndef MATRIX_SETTLE_US
+#   define MATRIX_SETTLE_US 30
+#endif
+
+#ifdef MATRIX_SETTLE_CALIBRATE
+/* iterations of _delay_loop_2(4 cycles) */
+#define MATRIX_SETTLE_LOOPS(us) ((uint16_t)(((us) * (F_CPU / 1000000UL) + 3) / 4))
+
+extern uint16_t matrix_settle_loops;
+
+/* drive_lines: drive input lines as keys are on, release_lines: set them to input again,
+ * lines_active: whether any line still reads on */
+void matrix_settle_calibrate(void (*drive_lines)(void), void (*release_lines)(void), bool (*lines_active)(void));
+/* settle time in us */
+uint8_t matrix_settle_us(void);
+
+#define matrix_settle_wait()    _delay_loop_2(matrix_settle_loops)
+#else
+#define matrix_settle_wait()    _delay_us(MATRIX_SETTLE_US)
+#endif
+
+#endif
@@ -2,10 +2,19 @@
 #include "matrix.h"
 #include "action.h"
 #include "backlight.h"
+#include "keyboard.h"
 
 
 void suspend_power_down(void)
 {
+#ifdef MATRIX_SCAN_ISR
+    // matrix is polled by suspend_wakeup_condition() during suspend
+    keyboard_scan_isr_disable();
+#endif
+#ifdef MATRIX_IDLE_SLEEP
+    // suspend_wakeup_condition() scans matrix
+    keyboard_idle_exit();
+#endif
 #ifdef BACKLIGHT_ENABLE
     backlight_set(0);
 #endif
@@ -54,6 +63,9 @@ void suspend_wakeup_init(void)
     // clear matrix and keyboard state
     matrix_init();
     clear_keyboard();
+#ifdef MATRIX_SCAN_ISR
+    keyboard_scan_isr_enable();
+#endif
 #ifdef BACKLIGHT_ENABLE
     backlight_init();
 #endif
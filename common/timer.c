@@ -83,6 +83,25 @@ uint32_t timer_read32(void)
     return t;
 }
 
+// high resolution time stamp
+uint32_t timer_read_fine(void)
+{
+    uint32_t t;
+    uint8_t raw;
+
+    uint8_t sreg = SREG;
+    cli();
+    t = timer_count;
+    raw = TIMER_RAW;
+    // Timer0 has wrapped but its interrupt is still pending
+    if ((TIFR0 & (1<<OCF0A)) && raw < TIMER_RAW_TOP/2) {
+        t++;
+    }
+    SREG = sreg;
+
+    return (t << 8) | raw;
+}
+
 inline
 uint16_t timer_elapsed(uint16_t last)
 {
@@ -45,6 +45,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define TIMER_DIFF_32(a, b)     TIMER_DIFF(a, b, UINT32_MAX)
 #define TIMER_DIFF_RAW(a, b)    TIMER_DIFF_8(a, b)
 
+/* timer_read_fine(): ms count in upper 24bits and Timer0 count in lower 8bits */
+#define TIMER_FINE_MS(t)        ((uint16_t)((t) >> 8))
+#define TIMER_FINE_RAW(t)       ((uint8_t)(t))
+
 
 #ifdef __cplusplus
 extern "C" {
@@ -57,6 +61,7 @@ void timer_init(void);
 void timer_clear(void);
 uint16_t timer_read(void);
 uint32_t timer_read32(void);
+uint32_t timer_read_fine(void);
 uint16_t timer_elapsed(uint16_t last);
 uint32_t timer_elapsed32(uint32_t last);
 
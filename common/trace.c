@@ -0,0 +1,95 @@
+/*
+Copyright 2013 Jun Wako <wakojun@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdint.h>
+#include "keyboard.h"
+#include "timer.h"
+#include "print.h"
+#include "host.h"
+#include "trace.h"
+
+
+#define TRACE_MASK  (TRACE_SIZE - 1)
+
+typedef struct {
+    uint8_t  type;
+    uint16_t time;
+    uint32_t data;
+} trace_t;
+
+static trace_t traces[TRACE_SIZE];
+static uint8_t trace_head = 0;
+static uint8_t trace_count = 0;
+
+
+/* oldest record is overwritten when buffer is full */
+void trace_record(uint8_t type, uint16_t time, uint32_t data)
+{
+    trace_t *t = &traces[trace_head];
+    t->type = type;
+    t->time = time;
+    t->data = data;
+    trace_head = (trace_head + 1) & TRACE_MASK;
+    if (trace_count < TRACE_SIZE) trace_count++;
+}
+
+void trace_report(report_keyboard_t *report)
+{
+    uint8_t n = 0;
+    uint8_t k[3] = {};
+
+#ifdef NKRO_ENABLE
+    if (keyboard_nkro) {
+        for (uint8_t i = 0; i < REPORT_BITS * 8; i++) {
+            if (!(report->nkro.bits[i>>3] & 1<<(i&7))) continue;
+            if (n < 3) k[n] = i;
+            n++;
+        }
+    } else
+#endif
+    {
+        for (uint8_t i = 0; i < REPORT_KEYS; i++) {
+            if (!report->keys[i]) continue;
+            if (n < 3) k[n] = report->keys[i];
+            n++;
+        }
+    }
+    if (n > 15) n = 15;
+    trace_record(TRACE_REPORT | n<<4, timer_read(),
+                 report->mods | (uint16_t)k[0]<<8 | (uint32_t)k[1]<<16 | (uint32_t)k[2]<<24);
+}
+
+void trace_clear(void)
+{
+    trace_head = 0;
+    trace_count = 0;
+}
+
+/* one record per line: '~' and 7 bytes in hex */
+void trace_dump(void)
+{
+    uint8_t i = (trace_head - trace_count) & TRACE_MASK;
+
+    xprintf("\ntrace: %u\n", trace_count);
+    for (uint8_t n = 0; n < trace_count; n++) {
+        trace_t *t = &traces[i];
+        xprintf("~%02X%02X%02X%02X%02X%02X%02X\n", t->type,
+                t->time & 0xFF, t->time >> 8,
+                (uint8_t)t->data, (uint8_t)(t->data >> 8),
+                (uint8_t)(t->data >> 16), (uint8_t)(t->data >> 24));
+        i = (i + 1) & TRACE_MASK;
+    }
+}
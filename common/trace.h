@@ -0,0 +1,84 @@
+/*
+Copyright 2013 Jun Wako <wakojun@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include "keyboard.h"
+#include "report.h"
+
+
+/* Event trace recorder
+ *
+ * Keeps last TRACE_SIZE records in RAM ring buffer and dumps them as hex on
+ * console. sim/trace_decode.c rebuilds timeline from the dump.
+ *
+ * record: type(1) time(2) data(4), little endian in dump
+ *   TRACE_KEY      key event:      row | col<<8 | pressed<<16
+ *   TRACE_PROCESS  process_action: row | col<<8 | pressed<<16 | interrupted<<20 | tap.count<<24
+ *   TRACE_LAYER    layer_state
+ *   TRACE_DEFAULT  default_layer_state
+ *   TRACE_REPORT   keyboard report: mods | keys[0]<<8 | keys[1]<<16 | keys[2]<<24
+ *                  number of keys in upper 4 bits of type
+ */
+#ifndef TRACE_SIZE
+#define TRACE_SIZE  32
+#endif
+
+#if (TRACE_SIZE & (TRACE_SIZE - 1)) || (TRACE_SIZE > 128)
+#   error "TRACE_SIZE must be power of 2 and not exceed 128"
+#endif
+
+enum trace_type {
+    TRACE_KEY = 1,
+    TRACE_PROCESS,
+    TRACE_LAYER,
+    TRACE_DEFAULT,
+    TRACE_REPORT,
+};
+
+
+#ifdef TRACE_ENABLE
+
+void trace_record(uint8_t type, uint16_t time, uint32_t data);
+void trace_dump(void);
+void trace_clear(void);
+
+#define trace_key(event) \
+    trace_record(TRACE_KEY, (event).time, \
+                 (event).key.row | (uint16_t)(event).key.col<<8 | (uint32_t)(event).pressed<<16)
+#define trace_process(event, tap) \
+    trace_record(TRACE_PROCESS, (event).time, \
+                 (event).key.row | (uint16_t)(event).key.col<<8 | (uint32_t)(event).pressed<<16 | \
+                 (uint32_t)(tap).interrupted<<20 | (uint32_t)(tap).count<<24)
+#define trace_layer(type, state) \
+    trace_record(type, timer_read(), state)
+void trace_report(report_keyboard_t *report);
+
+#else
+
+#define trace_record(type, time, data)
+#define trace_dump()
+#define trace_clear()
+#define trace_key(event)
+#define trace_process(event, tap)
+#define trace_layer(type, state)
+#define trace_report(report)
+
+#endif
+
+#endif
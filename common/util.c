@@ -78,6 +78,34 @@ uint8_t biton32(uint32_t bits)
     return n;
 }
 
+// least significant on-bit - return lowest location of on-bit
+// NOTE: return 0 when bit0 is on or all bits are off
+uint8_t bitctz(uint8_t bits)
+{
+    uint8_t n = 0;
+    if (!bits) return 0;
+    if (!(bits & 0x0F)) { bits >>= 4; n += 4;}
+    if (!(bits & 0x03)) { bits >>= 2; n += 2;}
+    if (!(bits & 0x01)) { n += 1;}
+    return n;
+}
+
+uint8_t bitctz16(uint16_t bits)
+{
+    uint8_t n = 0;
+    if (!bits) return 0;
+    if (!(bits & 0x00FF)) { bits >>= 8; n += 8;}
+    return n + bitctz(bits);
+}
+
+uint8_t bitctz32(uint32_t bits)
+{
+    uint8_t n = 0;
+    if (!bits) return 0;
+    if (!(bits & 0x0000FFFF)) { bits >>=16; n +=16;}
+    return n + bitctz16(bits);
+}
+
 
 
 uint8_t bitrev(uint8_t bits)
@@ -99,3 +127,24 @@ uint32_t bitrev32(uint32_t bits)
     bits = (uint32_t)bitrev16(bits & 0x0000ffff)<<16 | bitrev16((bits & 0xffff0000)>>16);
     return bits;
 }
+
+// transpose 8x8 bit matrix in place - bit j of m[i] <-> bit i of m[j]
+// e.g. column reads of a column-driven matrix into row words
+void bittranspose(uint8_t m[8])
+{
+    uint32_t lo = m[0] | (uint16_t)m[1]<<8 | (uint32_t)m[2]<<16 | (uint32_t)m[3]<<24;
+    uint32_t hi = m[4] | (uint16_t)m[5]<<8 | (uint32_t)m[6]<<16 | (uint32_t)m[7]<<24;
+    uint32_t t;
+
+    // swap bits in 2x2 blocks
+    t = (lo ^ (lo >> 7)) & 0x00AA00AA; lo ^= t ^ (t << 7);
+    t = (hi ^ (hi >> 7)) & 0x00AA00AA; hi ^= t ^ (t << 7);
+    // swap 2x2 blocks in 4x4 blocks
+    t = (lo ^ (lo >> 14)) & 0x0000CCCC; lo ^= t ^ (t << 14);
+    t = (hi ^ (hi >> 14)) & 0x0000CCCC; hi ^= t ^ (t << 14);
+    // swap 4x4 blocks
+    t = ((lo >> 4) ^ hi) & 0x0F0F0F0F; hi ^= t; lo ^= t << 4;
+
+    m[0] = lo; m[1] = lo>>8; m[2] = lo>>16; m[3] = lo>>24;
+    m[4] = hi; m[5] = hi>>8; m[6] = hi>>16; m[7] = hi>>24;
+}
@@ -26,6 +26,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "util.h"
 #include "debug.h"
 #include "adb.h"
+#include "timer.h"
 #include "matrix.h"
 
 
@@ -40,11 +41,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 static bool is_modified = false;
 
 // matrix state buffer(1:on, 0:off)
-#if (MATRIX_COLS <= 8)
-static uint8_t matrix[MATRIX_ROWS];
-#else
-static uint16_t matrix[MATRIX_ROWS];
-#endif
+static matrix_row_t matrix[MATRIX_ROWS];
 
 #ifdef MATRIX_HAS_GHOST
 static bool matrix_has_ghost_in_row(uint8_t row);
@@ -70,6 +67,7 @@ void matrix_init(void)
 
     // initialize matrix state: all keys off
     for (uint8_t i=0; i < MATRIX_ROWS; i++) matrix[i] = 0x00;
+    matrix_dirty_mark(MATRIX_DIRTY_ALL);
 
     debug_enable = true;
     debug_matrix = true;
@@ -103,6 +101,7 @@ uint8_t matrix_scan(void)
         if (debug_matrix) print("adb_host_kbd_recv: ERROR(matrix cleared.)\n");
         // clear matrix to unregister all keys
         for (uint8_t i=0; i < MATRIX_ROWS; i++) matrix[i] = 0x00;
+        matrix_dirty_mark(MATRIX_DIRTY_ALL);
         return key1;
     } else {
         register_key(key0);
@@ -133,15 +132,11 @@ bool matrix_has_ghost(void)
 inline
 bool matrix_is_on(uint8_t row, uint8_t col)
 {
-    return (matrix[row] & (1<<col));
+    return (matrix[row] & MATRIX_ROW_BIT(col));
 }
 
 inline
-#if (MATRIX_COLS <= 8)
-uint8_t matrix_get_row(uint8_t row)
-#else
-uint16_t matrix_get_row(uint8_t row)
-#endif
+matrix_row_t matrix_get_row(uint8_t row)
 {
     return matrix[row];
 }
@@ -149,18 +144,10 @@ uint16_t matrix_get_row(uint8_t row)
 void matrix_print(void)
 {
     if (!debug_matrix) return;
-#if (MATRIX_COLS <= 8)
-    print("r/c 01234567\n");
-#else
-    print("r/c 0123456789ABCDEF\n");
-#endif
+    print(MATRIX_ROW_HEADER "\n");
     for (uint8_t row = 0; row < matrix_rows(); row++) {
         phex(row); print(": ");
-#if (MATRIX_COLS <= 8)
-        pbin_reverse(matrix_get_row(row));
-#else
-        pbin_reverse16(matrix_get_row(row));
-#endif
+        MATRIX_ROW_PRINT(matrix_get_row(row));
 #ifdef MATRIX_HAS_GHOST
         if (matrix_has_ghost_in_row(row)) {
             print(" <ghost");
@@ -174,11 +161,7 @@ uint8_t matrix_key_count(void)
 {
     uint8_t count = 0;
     for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
-#if (MATRIX_COLS <= 8)
-        count += bitpop(matrix[i]);
-#else
-        count += bitpop16(matrix[i]);
-#endif
+        count += MATRIX_ROW_BITPOP(matrix[i]);
     }
     return count;
 }
@@ -188,7 +171,7 @@ inline
 static bool matrix_has_ghost_in_row(uint8_t row)
 {
     // no ghost exists in case less than 2 keys on
-    if (((matrix[row] - 1) & matrix[row]) == 0)
+    if (MATRIX_ROW_SINGLE(matrix[row]))
         return false;
 
     // ghost exists in case same state as other row
@@ -207,9 +190,11 @@ static void register_key(uint8_t key)
     col = key&0x07;
     row = (key>>3)&0x0F;
     if (key&0x80) {
-        matrix[row] &= ~(1<<col);
+        matrix[row] &= ~MATRIX_ROW_BIT(col);
     } else {
-        matrix[row] |=  (1<<col);
+        matrix[row] |=  MATRIX_ROW_BIT(col);
     }
     is_modified = true;
+    matrix_dirty_mark(MATRIX_DIRTY_ROW(row));
+    matrix_key_event(row, col, !(key&0x80), timer_read_fine());
 }
@@ -31,6 +31,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define MATRIX_ROWS 14
 #define MATRIX_COLS 8
 
+/* decoder pushes key events instead of matrix comparison */
+#define MATRIX_KEY_EVENT
+
 
 /* legacy keymap support */
 #define USE_LEGACY_KEYMAP
@@ -28,6 +28,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "host.h"
 #include "led.h"
 #include "m0110.h"
+#include "timer.h"
 #include "matrix.h"
 
 
@@ -40,8 +41,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 static bool is_modified = false;
 
 // matrix state buffer(1:on, 0:off)
-static uint8_t *matrix;
-static uint8_t _matrix0[MATRIX_ROWS];
+static matrix_row_t *matrix;
+static matrix_row_t _matrix0[MATRIX_ROWS];
 
 static void register_key(uint8_t key);
 
@@ -64,6 +65,7 @@ void matrix_init(void)
     // initialize matrix state: all keys off
     for (uint8_t i=0; i < MATRIX_ROWS; i++) _matrix0[i] = 0x00;
     matrix = _matrix0;
+    matrix_dirty_mark(MATRIX_DIRTY_ALL);
     return;
 }
 
@@ -103,21 +105,21 @@ bool matrix_has_ghost(void)
 inline
 bool matrix_is_on(uint8_t row, uint8_t col)
 {
-    return (matrix[row] & (1<<col));
+    return (matrix[row] & MATRIX_ROW_BIT(col));
 }
 
 inline
-uint8_t matrix_get_row(uint8_t row)
+matrix_row_t matrix_get_row(uint8_t row)
 {
     return matrix[row];
 }
 
 void matrix_print(void)
 {
-    print("\nr/c 01234567\n");
+    print("\n" MATRIX_ROW_HEADER "\n");
     for (uint8_t row = 0; row < matrix_rows(); row++) {
         phex(row); print(": ");
-        pbin_reverse(matrix_get_row(row));
+        MATRIX_ROW_PRINT(matrix_get_row(row));
         print("\n");
     }
 }
@@ -126,7 +128,7 @@ uint8_t matrix_key_count(void)
 {
     uint8_t count = 0;
     for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
-        count += bitpop(matrix[i]);
+        count += MATRIX_ROW_BITPOP(matrix[i]);
     }
     return count;
 }
@@ -135,8 +137,10 @@ inline
 static void register_key(uint8_t key)
 {
     if (key&0x80) {
-        matrix[ROW(key)] &= ~(1<<COL(key));
+        matrix[ROW(key)] &= ~MATRIX_ROW_BIT(COL(key));
     } else {
-        matrix[ROW(key)] |=  (1<<COL(key));
+        matrix[ROW(key)] |=  MATRIX_ROW_BIT(COL(key));
     }
+    matrix_dirty_mark(MATRIX_DIRTY_ROW(ROW(key)));
+    matrix_key_event(ROW(key), COL(key), !(key&0x80), timer_read_fine());
 }
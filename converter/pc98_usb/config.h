@@ -30,6 +30,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define MATRIX_ROWS     16
 #define MATRIX_COLS     8
 
+/* decoder pushes key events instead of matrix comparison */
+#define MATRIX_KEY_EVENT
+
 /* key combination for command */
 #define IS_COMMAND()    ( \
     host_get_first_key() == KC_CANCEL \
@@ -31,6 +31,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define MATRIX_ROWS 32  // keycode bit: 3-0
 #define MATRIX_COLS 8   // keycode bit: 6-4
 
+/* decoder pushes key events instead of matrix comparison */
+#define MATRIX_KEY_EVENT
+
 
 /* key combination for command */
 #define IS_COMMAND() ( \
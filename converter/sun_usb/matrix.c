@@ -21,6 +21,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <util/delay.h>
 #include "print.h"
 #include "util.h"
+#include "timer.h"
 #include "matrix.h"
 #include "debug.h"
 #include "protocol/serial.h"
@@ -42,7 +43,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
  *  F|78 ... 7F|
  *   +---------+
  */
-static uint8_t matrix[MATRIX_ROWS];
+static matrix_row_t matrix[MATRIX_ROWS];
 #define ROW(code)      ((code>>3)&0xF)
 #define COL(code)      (code&0x07)
 
@@ -70,6 +71,7 @@ void matrix_init(void)
 
     // initialize matrix state: all keys off
     for (uint8_t i=0; i < MATRIX_ROWS; i++) matrix[i] = 0x00;
+    matrix_dirty_mark(MATRIX_DIRTY_ALL);
 
     return;
 }
@@ -97,20 +99,25 @@ uint8_t matrix_scan(void)
         case 0x7F:
             // all keys up
             for (uint8_t i=0; i < MATRIX_ROWS; i++) matrix[i] = 0x00;
+            matrix_dirty_mark(MATRIX_DIRTY_ALL);
             return 0;
     }
 
     if (code&0x80) {
         // break code
         if (matrix_is_on(ROW(code), COL(code))) {
-            matrix[ROW(code)] &= ~(1<<COL(code));
+            matrix[ROW(code)] &= ~MATRIX_ROW_BIT(COL(code));
             is_modified = true;
+            matrix_dirty_mark(MATRIX_DIRTY_ROW(ROW(code)));
+            matrix_key_event(ROW(code), COL(code), false, timer_read_fine());
         }
     } else {
         // make code
         if (!matrix_is_on(ROW(code), COL(code))) {
-            matrix[ROW(code)] |=  (1<<COL(code));
+            matrix[ROW(code)] |=  MATRIX_ROW_BIT(COL(code));
             is_modified = true;
+            matrix_dirty_mark(MATRIX_DIRTY_ROW(ROW(code)));
+            matrix_key_event(ROW(code), COL(code), true, timer_read_fine());
         }
     }
     return code;
@@ -130,21 +137,21 @@ bool matrix_has_ghost(void)
 inline
 bool matrix_is_on(uint8_t row, uint8_t col)
 {
-    return (matrix[row] & (1<<col));
+    return (matrix[row] & MATRIX_ROW_BIT(col));
 }
 
 inline
-uint8_t matrix_get_row(uint8_t row)
+matrix_row_t matrix_get_row(uint8_t row)
 {
     return matrix[row];
 }
 
 void matrix_print(void)
 {
-    print("\nr/c 01234567\n");
+    print("\n" MATRIX_ROW_HEADER "\n");
     for (uint8_t row = 0; row < matrix_rows(); row++) {
         phex(row); print(": ");
-        pbin_reverse(matrix_get_row(row));
+        MATRIX_ROW_PRINT(matrix_get_row(row));
         print("\n");
     }
 }
@@ -153,7 +160,7 @@ uint8_t matrix_key_count(void)
 {
     uint8_t count = 0;
     for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
-        count += bitpop(matrix[i]);
+        count += MATRIX_ROW_BITPOP(matrix[i]);
     }
     return count;
 }
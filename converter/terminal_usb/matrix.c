@@ -23,6 +23,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "util.h"
 #include "debug.h"
 #include "ps2.h"
+#include "timer.h"
 #include "matrix.h"
 
 
@@ -45,7 +46,7 @@ static bool matrix_has_ghost_in_row(uint8_t row);
  * 17|         |
  *   +---------+
  */
-static uint8_t matrix[MATRIX_ROWS];
+static matrix_row_t matrix[MATRIX_ROWS];
 #define ROW(code)      (code>>3)
 #define COL(code)      (code&0x07)
 
@@ -75,6 +76,7 @@ void matrix_init(void)
 
     // initialize matrix state: all keys off
     for (uint8_t i=0; i < MATRIX_ROWS; i++) matrix[i] = 0x00;
+    matrix_dirty_mark(MATRIX_DIRTY_ALL);
 
     return;
 }
@@ -192,21 +194,21 @@ bool matrix_has_ghost(void)
 inline
 bool matrix_is_on(uint8_t row, uint8_t col)
 {
-    return (matrix[row] & (1<<col));
+    return (matrix[row] & MATRIX_ROW_BIT(col));
 }
 
 inline
-uint8_t matrix_get_row(uint8_t row)
+matrix_row_t matrix_get_row(uint8_t row)
 {
     return matrix[row];
 }
 
 void matrix_print(void)
 {
-    print("\nr/c 01234567\n");
+    print("\n" MATRIX_ROW_HEADER "\n");
     for (uint8_t row = 0; row < matrix_rows(); row++) {
         phex(row); print(": ");
-        pbin_reverse(matrix_get_row(row));
+        MATRIX_ROW_PRINT(matrix_get_row(row));
 #ifdef MATRIX_HAS_GHOST
         if (matrix_has_ghost_in_row(row)) {
             print(" <ghost");
@@ -220,7 +222,7 @@ uint8_t matrix_key_count(void)
 {
     uint8_t count = 0;
     for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
-        count += bitpop(matrix[i]);
+        count += MATRIX_ROW_BITPOP(matrix[i]);
     }
     return count;
 }
@@ -230,7 +232,7 @@ inline
 static bool matrix_has_ghost_in_row(uint8_t row)
 {
     // no ghost exists in case less than 2 keys on
-    if (((matrix[row] - 1) & matrix[row]) == 0)
+    if (MATRIX_ROW_SINGLE(matrix[row]))
         return false;
 
     // ghost exists in case same state as other row
@@ -247,8 +249,10 @@ inline
 static void matrix_make(uint8_t code)
 {
     if (!matrix_is_on(ROW(code), COL(code))) {
-        matrix[ROW(code)] |= 1<<COL(code);
+        matrix[ROW(code)] |= MATRIX_ROW_BIT(COL(code));
         is_modified = true;
+        matrix_dirty_mark(MATRIX_DIRTY_ROW(ROW(code)));
+        matrix_key_event(ROW(code), COL(code), true, timer_read_fine());
     }
 }
 
@@ -256,7 +260,9 @@ inline
 static void matrix_break(uint8_t code)
 {
     if (matrix_is_on(ROW(code), COL(code))) {
-        matrix[ROW(code)] &= ~(1<<COL(code));
+        matrix[ROW(code)] &= ~MATRIX_ROW_BIT(COL(code));
         is_modified = true;
+        matrix_dirty_mark(MATRIX_DIRTY_ROW(ROW(code)));
+        matrix_key_event(ROW(code), COL(code), false, timer_read_fine());
     }
 }
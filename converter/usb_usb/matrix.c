@@ -22,6 +22,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "util.h"
 #include "print.h"
 #include "debug.h"
+#include "timer.h"
 #include "matrix.h"
 
 /* KEY CODE to Matrix
@@ -51,10 +52,61 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 uint8_t matrix_rows(void) { return MATRIX_ROWS; }
 uint8_t matrix_cols(void) { return MATRIX_COLS; }
-void matrix_init(void) {}
+void matrix_init(void) { matrix_dirty_mark(MATRIX_DIRTY_ALL); }
 bool matrix_has_ghost(void) { return false; }
 
 static bool matrix_is_mod =false;
+static report_keyboard_t last_report;
+
+/* rows which have keys down in the report */
+static matrix_dirty_t report_rows(report_keyboard_t *report) {
+    matrix_dirty_t rows = 0;
+
+    if (report->mods) {
+        rows |= MATRIX_DIRTY_ROW(ROW(KC_LCTRL));
+    }
+    for (uint8_t i = 0; i < REPORT_KEYS; i++) {
+        if (IS_ANY(report->keys[i])) {
+            rows |= MATRIX_DIRTY_ROW(ROW(report->keys[i]));
+        }
+    }
+    return rows;
+}
+
+#ifdef MATRIX_KEY_EVENT
+static bool report_has_key(report_keyboard_t *report, uint8_t code) {
+    for (uint8_t i = 0; i < REPORT_KEYS; i++) {
+        if (report->keys[i] == code) return true;
+    }
+    return false;
+}
+
+/* key events from difference of reports: releases first, then presses */
+static void report_events(report_keyboard_t *prev, report_keyboard_t *now, uint32_t time) {
+    uint8_t mods_change = prev->mods ^ now->mods;
+
+    for (uint8_t i = 0; i < 8; i++) {
+        if ((mods_change & (1<<i)) && !(now->mods & (1<<i))) {
+            matrix_key_event(ROW(KC_LCTRL + i), COL(KC_LCTRL + i), false, time);
+        }
+    }
+    for (uint8_t i = 0; i < REPORT_KEYS; i++) {
+        if (IS_ANY(prev->keys[i]) && !report_has_key(now, prev->keys[i])) {
+            matrix_key_event(ROW(prev->keys[i]), COL(prev->keys[i]), false, time);
+        }
+    }
+    for (uint8_t i = 0; i < 8; i++) {
+        if ((mods_change & (1<<i)) && (now->mods & (1<<i))) {
+            matrix_key_event(ROW(KC_LCTRL + i), COL(KC_LCTRL + i), true, time);
+        }
+    }
+    for (uint8_t i = 0; i < REPORT_KEYS; i++) {
+        if (IS_ANY(now->keys[i]) && !report_has_key(prev, now->keys[i])) {
+            matrix_key_event(ROW(now->keys[i]), COL(now->keys[i]), true, time);
+        }
+    }
+}
+#endif
 
 uint8_t matrix_scan(void) {
     static uint16_t last_time_stamp = 0;
@@ -62,6 +114,12 @@ uint8_t matrix_scan(void) {
     if (last_time_stamp != usb_hid_time_stamp) {
         last_time_stamp = usb_hid_time_stamp;
         matrix_is_mod = true;
+        // rows of keys released and pressed
+        matrix_dirty_mark(report_rows(&last_report) | report_rows(&usb_hid_keyboard_report));
+#ifdef MATRIX_KEY_EVENT
+        report_events(&last_report, &usb_hid_keyboard_report, timer_read_fine());
+#endif
+        last_report = usb_hid_keyboard_report;
     } else {
         matrix_is_mod = false;
     }
@@ -89,7 +147,7 @@ bool matrix_is_on(uint8_t row, uint8_t col) {
     return false;
 }
 
-uint8_t matrix_get_row(uint8_t row) {
+matrix_row_t matrix_get_row(uint8_t row) {
     uint8_t row_bits = 0;
 
     if (IS_MOD(CODE(row, 0)) && usb_hid_keyboard_report.mods) {
@@ -119,10 +177,10 @@ uint8_t matrix_key_count(void) {
 }
 
 void matrix_print(void) {
-    print("\nr/c 01234567\n");
+    print("\n" MATRIX_ROW_HEADER "\n");
     for (uint8_t row = 0; row < matrix_rows(); row++) {
         phex(row); print(": ");
-        pbin_reverse(matrix_get_row(row));
+        MATRIX_ROW_PRINT(matrix_get_row(row));
 #ifdef MATRIX_HAS_GHOST
         if (matrix_has_ghost_in_row(row)) {
             print(" <ghost");
@@ -27,6 +27,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "util.h"
 #include "matrix.h"
 #include "led.h"
+#include "host.h"
+#include "debounce.h"
+#include "matrix_settle.h"
 
 
 #if (MATRIX_COLS > 16)
@@ -37,30 +40,20 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #endif
 
 
-#ifndef DEBOUNCE
-#   define DEBOUNCE	0
-#endif
-static uint8_t debouncing = DEBOUNCE;
-
 // matrix state buffer(1:on, 0:off)
-#if (MATRIX_COLS <= 8)
-static uint8_t *matrix;
-static uint8_t *matrix_prev;
-static uint8_t _matrix0[MATRIX_ROWS];
-static uint8_t _matrix1[MATRIX_ROWS];
-#else
-static uint16_t *matrix;
-static uint16_t *matrix_prev;
-static uint16_t _matrix0[MATRIX_ROWS];
-static uint16_t _matrix1[MATRIX_ROWS];
-#endif
+static matrix_row_t matrix[MATRIX_ROWS];
 
 #ifdef MATRIX_HAS_GHOST
 static bool matrix_has_ghost_in_row(uint8_t row);
 #endif
+static void init_cols(void);
 static uint8_t read_col(uint8_t row);
 static void unselect_rows(void);
 static void select_row(uint8_t row);
+#ifdef MATRIX_SETTLE_CALIBRATE
+static void drive_cols(void);
+static bool cols_active(void);
+#endif
 
 
 inline
@@ -79,13 +72,10 @@ void matrix_init(void)
 {
     // initialize row and col
     unselect_rows();
-    // Input with pull-up(DDR:0, PORT:1)
-	// Column C1 ~ C7 (PortC0-6)
-	// Column C0(Port E1)
-    DDRC &= ~0b01111111;
-    PORTC |= 0b01111111;
-    DDRE &= ~0b00000010;
-    PORTE |= 0b00000010;
+    init_cols();
+#ifdef MATRIX_SETTLE_CALIBRATE
+    matrix_settle_calibrate(drive_cols, init_cols, cols_active);
+#endif
 	//DDRB &= ~0b00000100;
 	//PORTB |= 0b00000100;
 	// modifier	B3/4,F4/5,E4	always input
@@ -104,68 +94,36 @@ void matrix_init(void)
     //PORTE |= 0b00010000;
 
     // initialize matrix state: all keys off
-    for (uint8_t i=0; i < MATRIX_ROWS; i++) _matrix0[i] = 0x00;
-    for (uint8_t i=0; i < MATRIX_ROWS; i++) _matrix1[i] = 0x00;
-    matrix = _matrix0;
-    matrix_prev = _matrix1;
+    for (uint8_t i=0; i < MATRIX_ROWS; i++) matrix[i] = 0x00;
+    debounce_init();
 }
 
 uint8_t matrix_scan(void)
 {
-    if (!debouncing) {
-        uint8_t *tmp = matrix_prev;
-        matrix_prev = matrix;
-        matrix = tmp;
-    }
-
     for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
         unselect_rows();
         select_row(i);
-        _delay_us(30);  // without this wait read unstable value.
+        matrix_settle_wait();
+        matrix_row_t cols = (uint8_t)~read_col(i);
 		if ( i == ( MATRIX_ROWS - 1 ) ) {							// CHECK CAPS LOCK
        		if (host_keyboard_leds() & (1<<USB_LED_CAPS_LOCK)) {		// CAPS LOCK is ON on HOST
-				if ( ~read_col(i) & (1<< 4) ) { 							// CAPS LOCK is still DOWN ( 0bXXX1_XXXX)	
-					matrix[i]        = ~read_col(i) & 0b11101111;				// change CAPS LOCK as released
+				if ( cols & (1<< 4) ) { 							// CAPS LOCK is still DOWN ( 0bXXX1_XXXX)	
+					cols &= 0b11101111;								// change CAPS LOCK as released
 				} else {													// CAPS LOCK in UP
-					matrix[i] = ~read_col(i) | 0b00010000;						// send fake caps lock down
-				}
-			} else {													// CAPS LOCK is OFF on HOST
-        		if (matrix[i] != (uint8_t)~read_col(i)) {
-           			matrix[i] = (uint8_t)~read_col(i);
-        			if (debouncing) {
-        				debug("bounce!: "); debug_hex(debouncing); print("\n");
-					}
-       				debouncing = DEBOUNCE;
-				}
-			}
-		} else {
-        	if (matrix[i] != (uint8_t)~read_col(i)) {
-           		matrix[i] = (uint8_t)~read_col(i);
-        		if (debouncing) {
-        			debug("bounce!: "); debug_hex(debouncing); print("\n");
+					cols |= 0b00010000;								// send fake caps lock down
 				}
-       			debouncing = DEBOUNCE;
 			}
 		}
+        debounce_row(i, cols, &matrix[i]);
 	}
     unselect_rows();
 
-    if (debouncing) {
-        debouncing--;
-    }
-
     return 1;
 }
 
 bool matrix_is_modified(void)
 {
-    if (debouncing) return false;
-    for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
-        if (matrix[i] != matrix_prev[i]) {
-            return true;
-        }
-    }
-    return false;
+    return true;
 }
 
 inline
@@ -193,29 +151,21 @@ bool matrix_is_on(uint8_t row, uint8_t col)
 //			}
 //		} 
 //	}
-   	return (matrix[row] & (1<<col));
+   	return (matrix[row] & MATRIX_ROW_BIT(col));
 }
 
 inline
-#if (MATRIX_COLS <= 8)
-uint8_t matrix_get_row(uint8_t row)
-#else
-uint16_t matrix_get_row(uint8_t row)
-#endif
+matrix_row_t matrix_get_row(uint8_t row)
 {
     return matrix[row];
 }
 
 void matrix_print(void)
 {
-    print("\nr/c 01234567\n");
+    print("\n" MATRIX_ROW_HEADER "\n");
     for (uint8_t row = 0; row < matrix_rows(); row++) {
         phex(row); print(": ");
-#if (MATRIX_COLS <= 8)
-        pbin_reverse(matrix_get_row(row));
-#else
-        pbin_reverse16(matrix_get_row(row));
-#endif
+        MATRIX_ROW_PRINT(matrix_get_row(row));
 #ifdef MATRIX_HAS_GHOST
         if (matrix_has_ghost_in_row(row)) {
             print(" <ghost");
@@ -229,11 +179,7 @@ uint8_t matrix_key_count(void)
 {
     uint8_t count = 0;
     for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
-#if (MATRIX_COLS <= 8)
-        count += bitpop(matrix[i]);
-#else
-        count += bitpop16(matrix[i]);
-#endif
+        count += MATRIX_ROW_BITPOP(matrix[i]);
     }
     return count;
 }
@@ -243,7 +189,7 @@ inline
 static bool matrix_has_ghost_in_row(uint8_t row)
 {
     // no ghost exists in case less than 2 keys on
-    if (((matrix[row] - 1) & matrix[row]) == 0)
+    if (MATRIX_ROW_SINGLE(matrix[row]))
         return false;
 
     // ghost exists in case same state as other row
@@ -255,6 +201,33 @@ static bool matrix_has_ghost_in_row(uint8_t row)
 }
 #endif
 
+static void init_cols(void)
+{
+    // Input with pull-up(DDR:0, PORT:1)
+	// Column C1 ~ C7 (PortC0-6)
+	// Column C0(Port E1)
+    DDRC &= ~0b01111111;
+    PORTC |= 0b01111111;
+    DDRE &= ~0b00000010;
+    PORTE |= 0b00000010;
+}
+
+#ifdef MATRIX_SETTLE_CALIBRATE
+static void drive_cols(void)
+{
+    // Output low(DDR:1, PORT:0)
+    PORTC &= ~0b01111111;
+    DDRC |= 0b01111111;
+    PORTE &= ~0b00000010;
+    DDRE |= 0b00000010;
+}
+
+static bool cols_active(void)
+{
+    return (uint8_t)~read_col(0);
+}
+#endif
+
 inline
 static uint8_t read_col(uint8_t row)
 {
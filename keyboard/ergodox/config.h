@@ -39,9 +39,12 @@ Project located at <https://github.com/benblazak/ergodox-firmware>
 /* define if matrix has ghost */
 //#define MATRIX_HAS_GHOST
 
-/* Set 0 if debouncing isn't needed */
+/* key release debounce time in ms. Set 0 if debouncing isn't needed */
 #define DEBOUNCE    5
 
+/* process keys of each row during scan over I2C */
+#define MATRIX_ROW_COMMIT
+
 /* Mechanical locking support. Use KC_LCAP, KC_LNUM or KC_LSCR instead in keymap */
 #define LOCKING_SUPPORT_ENABLE
 /* Locking resynchronize hack */
@@ -38,6 +38,7 @@ Most used files are located at
 #include "i2cmaster.h"
 
 bool i2c_initialized = 0;
+uint8_t mcp23018_status = 0x20;
 
 bool ergodox_left_led_1 = 0;  // left top
 bool ergodox_left_led_2 = 0;  // left middle
@@ -116,6 +117,33 @@ uint8_t init_mcp23018(void) {
 
 out:
     i2c_stop();
+    mcp23018_status = err;
+    return err;
+}
+
+uint8_t ergodox_left_leds_update(void)
+{
+    uint8_t err = 0x20;
+
+    // LEDs are set with other pins in init
+    if (mcp23018_status) {
+        return init_mcp23018();
+    }
+
+    // set logical value of LED pins, rows are left hi-Z
+    err = i2c_start(I2C_ADDR_WRITE);    if (err) goto out;
+    err = i2c_write(OLATA);             if (err) goto out;
+    err = i2c_write(0b11111111
+            & ~(ergodox_left_led_3<<LEFT_LED_3_SHIFT)
+          );                            if (err) goto out;
+    err = i2c_write(0b11111111
+            & ~(ergodox_left_led_2<<LEFT_LED_2_SHIFT)
+            & ~(ergodox_left_led_1<<LEFT_LED_1_SHIFT)
+          );                            if (err) goto out;
+
+out:
+    i2c_stop();
+    mcp23018_status = err;
     return err;
 }
 
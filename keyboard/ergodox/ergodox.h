@@ -47,6 +47,10 @@ Most used files are located at
 
 void init_ergodox(void);
 uint8_t init_mcp23018(void);
+uint8_t ergodox_left_leds_update(void);
+
+// error of last MCP23018 transfer, 0 when initialized and working
+extern uint8_t mcp23018_status;
 
 #define LED_BRIGHTNESS_LO       31
 #define LED_BRIGHTNESS_HI       255
@@ -75,8 +79,6 @@ inline void ergodox_left_led_1_off(void)    { ergodox_left_led_1 = 0; }
 inline void ergodox_left_led_2_off(void)    { ergodox_left_led_2 = 0; }
 inline void ergodox_left_led_3_off(void)    { ergodox_left_led_3 = 0; }
 
-inline void ergodox_left_leds_update(void)  { init_mcp23018(); }
-
 inline void ergodox_led_all_on(void)
 {
     ergodox_board_led_on();
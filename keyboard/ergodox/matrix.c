@@ -27,22 +27,34 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "debug.h"
 #include "util.h"
 #include "matrix.h"
+#include "debounce.h"
+#include "matrix_settle.h"
 #include "ergodox.h"
 #include "i2cmaster.h"
-
-#ifndef DEBOUNCE
-#   define DEBOUNCE	5
+#ifdef TWI_ASYNC
+#   include "twi_async.h"
 #endif
-static uint8_t debouncing = DEBOUNCE;
 
 /* matrix state(1:on, 0:off) */
 static matrix_row_t matrix[MATRIX_ROWS];
-static matrix_row_t matrix_debouncing[MATRIX_ROWS];
 
-static matrix_row_t read_cols(uint8_t mcp23018_status, uint8_t row);
+static matrix_row_t read_cols(void);
+#ifdef TWI_ASYNC
+static void mcp23018_rows_start(void);
+static matrix_row_t mcp23018_rows_read(uint8_t row);
+#else
+static matrix_row_t read_mcp23018_row(uint8_t row);
+#endif
 static void init_cols(void);
-static void unselect_rows(uint8_t mcp23018_status);
-static void select_row(uint8_t mcp23018_status, uint8_t row);
+static void unselect_rows(void);
+static void select_row(uint8_t row);
+#ifdef KEYMAP_CUB
+static void left_leds_update(void);
+#endif
+#ifdef MATRIX_SETTLE_CALIBRATE
+static void drive_cols(void);
+static bool cols_active(void);
+#endif
 
 
 inline
@@ -61,101 +73,79 @@ void matrix_init(void)
 {
     // initialize row and col
     init_ergodox();
-    uint8_t mcp23018_status;
-    mcp23018_status = init_mcp23018();
-    unselect_rows(mcp23018_status);
+    init_mcp23018();
+    unselect_rows();
     init_cols();
+#ifdef MATRIX_SETTLE_CALIBRATE
+    // only teensy side, MCP23018 side is slower to read than to settle
+    matrix_settle_calibrate(drive_cols, init_cols, cols_active);
+#endif
 
     // initialize matrix state: all keys off
     for (uint8_t i=0; i < MATRIX_ROWS; i++) {
         matrix[i] = 0;
-        matrix_debouncing[i] = 0;
     }
+    debounce_init();
 }
 
 uint8_t matrix_scan(void)
 {
 #ifdef KEYMAP_CUB
-    uint8_t layer = biton32(layer_state);
-
-    if (layer == 1) {
-        ergodox_left_led_1_on();
-        ergodox_left_led_2_off();
-        ergodox_left_led_3_off();
-    } else if (layer == 2) {
-        ergodox_left_led_1_off();
-        ergodox_left_led_2_on();
-        ergodox_left_led_3_off();
-    } else if (layer == 3) {
-        ergodox_left_led_1_off();
-        ergodox_left_led_2_off();
-        ergodox_left_led_3_on();
-    } else if (layer == 4) {
-        ergodox_left_led_1_on();
-        ergodox_left_led_2_off();
-        ergodox_left_led_3_on();
-    } else if (layer == 5) {
-        ergodox_left_led_1_on();
-        ergodox_left_led_2_on();
-        ergodox_left_led_3_off();
-    } else if (layer == 6) {
-        ergodox_left_led_1_off();
-        ergodox_left_led_2_on();
-        ergodox_left_led_3_on();
-    } else if (layer == 7) {
-        ergodox_left_led_1_on();
-        ergodox_left_led_2_on();
-        ergodox_left_led_3_on();
-    } else {
-        ergodox_left_led_1_off();
-        ergodox_left_led_2_off();
-        ergodox_left_led_3_off();
-    }
-
-    // not actually needed because we already calling init_mcp23018() in next line
-    // ergodox_left_leds_update();
-
+    left_leds_update();
 #endif
 
-    uint8_t mcp23018_status = init_mcp23018();
+    // MCP23018 keeps its state across scans; init again only after error
+    if (mcp23018_status) {
+        init_mcp23018();
+    }
 
-    for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
-        select_row(mcp23018_status, i);
-        _delay_us(30);  // without this wait read unstable value.
-        matrix_row_t cols = read_cols(mcp23018_status, i);
-        if (matrix_debouncing[i] != cols) {
-            matrix_debouncing[i] = cols;
-            if (debouncing) {
-                debug("bounce!: "); debug_hex(debouncing); debug("\n");
-            }
-            debouncing = DEBOUNCE;
+#ifdef TWI_ASYNC
+    // MCP23018 rows are read by TWI interrupt while teensy rows are scanned
+    mcp23018_rows_start();
+    for (uint8_t i = 7; i < MATRIX_ROWS; i++) {
+        select_row(i);
+        matrix_settle_wait();
+        matrix_row_t cols = read_cols();
+        unselect_rows();
+        if (debounce_row(i, cols, &matrix[i])) {
+            matrix_row_commit(i);
         }
-        unselect_rows(mcp23018_status);
     }
-
-    if (debouncing) {
-        if (--debouncing) {
-            _delay_ms(1);
+    for (uint8_t i = 0; i < 7; i++) {
+        if (debounce_row(i, mcp23018_rows_read(i), &matrix[i])) {
+            matrix_row_commit(i);
+        }
+    }
+#else
+    for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
+        matrix_row_t cols;
+        if (i < 7) {
+            // select and settle are in the I2C transfer
+            cols = read_mcp23018_row(i);
         } else {
-            for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
-                matrix[i] = matrix_debouncing[i];
-            }
+            select_row(i);
+            matrix_settle_wait();
+            cols = read_cols();
+            unselect_rows();
+        }
+        if (debounce_row(i, cols, &matrix[i])) {
+            matrix_row_commit(i);
         }
     }
+#endif
 
     return 1;
 }
 
 bool matrix_is_modified(void)
 {
-    if (debouncing) return false;
     return true;
 }
 
 inline
 bool matrix_is_on(uint8_t row, uint8_t col)
 {
-    return (matrix[row] & ((matrix_row_t)1<<col));
+    return (matrix[row] & MATRIX_ROW_BIT(col));
 }
 
 inline
@@ -166,10 +156,10 @@ matrix_row_t matrix_get_row(uint8_t row)
 
 void matrix_print(void)
 {
-    print("\nr/c 0123456789ABCDEF\n");
+    print("\n" MATRIX_ROW_HEADER "\n");
     for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
         phex(row); print(": ");
-        pbin_reverse16(matrix_get_row(row));
+        MATRIX_ROW_PRINT(matrix_get_row(row));
         print("\n");
     }
 }
@@ -178,11 +168,60 @@ uint8_t matrix_key_count(void)
 {
     uint8_t count = 0;
     for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
-        count += bitpop16(matrix[i]);
+        count += MATRIX_ROW_BITPOP(matrix[i]);
     }
     return count;
 }
 
+#ifdef KEYMAP_CUB
+/* left LEDs show layer; written to MCP23018 only when layer changes */
+static void left_leds_update(void)
+{
+    static uint8_t led_layer = 0xFF;
+    uint8_t layer = biton32(layer_state);
+    if (layer == led_layer) return;
+
+    if (layer == 1) {
+        ergodox_left_led_1_on();
+        ergodox_left_led_2_off();
+        ergodox_left_led_3_off();
+    } else if (layer == 2) {
+        ergodox_left_led_1_off();
+        ergodox_left_led_2_on();
+        ergodox_left_led_3_off();
+    } else if (layer == 3) {
+        ergodox_left_led_1_off();
+        ergodox_left_led_2_off();
+        ergodox_left_led_3_on();
+    } else if (layer == 4) {
+        ergodox_left_led_1_on();
+        ergodox_left_led_2_off();
+        ergodox_left_led_3_on();
+    } else if (layer == 5) {
+        ergodox_left_led_1_on();
+        ergodox_left_led_2_on();
+        ergodox_left_led_3_off();
+    } else if (layer == 6) {
+        ergodox_left_led_1_off();
+        ergodox_left_led_2_on();
+        ergodox_left_led_3_on();
+    } else if (layer == 7) {
+        ergodox_left_led_1_on();
+        ergodox_left_led_2_on();
+        ergodox_left_led_3_on();
+    } else {
+        ergodox_left_led_1_off();
+        ergodox_left_led_2_off();
+        ergodox_left_led_3_off();
+    }
+
+    // try again at next scan on error
+    if (ergodox_left_leds_update() == 0) {
+        led_layer = layer;
+    }
+}
+#endif
+
 /* Column pin configuration
  *
  * Teensy
@@ -204,35 +243,107 @@ static void  init_cols(void)
     PORTF |=  (1<<7 | 1<<6 | 1<<5 | 1<<4 | 1<<1 | 1<<0);
 }
 
-static matrix_row_t read_cols(uint8_t mcp23018_status, uint8_t row)
+#ifdef MATRIX_SETTLE_CALIBRATE
+static void drive_cols(void)
+{
+    // Output low(DDR:1, PORT:0)
+    PORTF &= ~(1<<7 | 1<<6 | 1<<5 | 1<<4 | 1<<1 | 1<<0);
+    DDRF  |=  (1<<7 | 1<<6 | 1<<5 | 1<<4 | 1<<1 | 1<<0);
+}
+
+static bool cols_active(void)
+{
+    return read_cols();
+}
+#endif
+
+static matrix_row_t read_cols(void)
 {
-    if (row < 7) {
+    // read from teensy
+    return
+        (PINF&(1<<0) ? 0 : (1<<0)) |
+        (PINF&(1<<1) ? 0 : (1<<1)) |
+        (PINF&(1<<4) ? 0 : (1<<2)) |
+        (PINF&(1<<5) ? 0 : (1<<3)) |
+        (PINF&(1<<6) ? 0 : (1<<4)) |
+        (PINF&(1<<7) ? 0 : (1<<5)) ;
+}
+
+#ifdef TWI_ASYNC
+static twi_xfer_t mcp23018_xfer[7];
+
+/* Queue select and read of each MCP23018 row. A transfer writes the row to
+ * GPIOA and reads GPIOB after repeated start(IOCON.SEQOP=0).
+ */
+static void mcp23018_rows_start(void)
+{
+    for (uint8_t row = 0; row < 7; row++) {
+        twi_xfer_t *x = &mcp23018_xfer[row];
         if (mcp23018_status) { // if there was an error
-            return 0;
-        } else {
-            uint8_t data = 0;
-            uint8_t err = 0x20;
-            err = i2c_start(I2C_ADDR_WRITE);    if (err) goto out;
-            err = i2c_write(GPIOB);             if (err) goto out;
-            err = i2c_start(I2C_ADDR_READ);     if (err) goto out;
-            data = i2c_readNak();
-            data = ~data;
-        out:
-            i2c_stop();
-            return data;
+            x->status = TWI_ERROR;
+            continue;
+        }
+        x->addr = I2C_ADDR;
+        x->wlen = 2;
+        x->wbuf[0] = GPIOA;
+        // set active row low  : 0
+        // set other rows hi-Z : 1
+        x->wbuf[1] = 0xFF & ~(1<<row) & ~(ergodox_left_led_3<<LEFT_LED_3_SHIFT);
+        x->rlen = 1;
+        if (!twi_async_submit(x)) {
+            x->status = TWI_ERROR;
         }
-    } else {
-        // read from teensy
-        return
-            (PINF&(1<<0) ? 0 : (1<<0)) |
-            (PINF&(1<<1) ? 0 : (1<<1)) |
-            (PINF&(1<<4) ? 0 : (1<<2)) |
-            (PINF&(1<<5) ? 0 : (1<<3)) |
-            (PINF&(1<<6) ? 0 : (1<<4)) |
-            (PINF&(1<<7) ? 0 : (1<<5)) ;
     }
 }
 
+/* columns of MCP23018 row after all transfers are done */
+static matrix_row_t mcp23018_rows_read(uint8_t row)
+{
+    // 7 transfers take about 3.5ms at 100kHz
+    for (uint16_t i = 0; twi_async_busy(); i++) {
+        if (i == 1000) {
+            twi_async_abort();
+            break;
+        }
+        _delay_us(10);
+    }
+
+    if (mcp23018_xfer[row].status != TWI_DONE) {
+        // init again at next scan
+        mcp23018_status = 0x20;
+        return 0;
+    }
+    return (uint8_t)~mcp23018_xfer[row].rbuf[0];
+}
+#else
+/* Select a row and read columns on MCP23018 in one transfer.
+ * Register address moves on from GPIOA to GPIOB after the write(IOCON.SEQOP=0)
+ * and the read after repeated start returns GPIOB. The row is left selected
+ * until next select; columns are read only in this transfer.
+ */
+static matrix_row_t read_mcp23018_row(uint8_t row)
+{
+    uint8_t data = 0;
+    if (mcp23018_status) { // if there was an error
+        return 0;
+    }
+
+    // set active row low  : 0
+    // set other rows hi-Z : 1
+    mcp23018_status = i2c_start(I2C_ADDR_WRITE);    if (mcp23018_status) goto out;
+    mcp23018_status = i2c_write(GPIOA);             if (mcp23018_status) goto out;
+    mcp23018_status = i2c_write( 0xFF & ~(1<<row)
+            & ~(ergodox_left_led_3<<LEFT_LED_3_SHIFT)
+          );                                        if (mcp23018_status) goto out;
+    mcp23018_status = i2c_rep_start(I2C_ADDR_READ); if (mcp23018_status) goto out;
+    data = i2c_readNak();
+    data = ~data;
+out:
+    i2c_stop();
+    return data;
+}
+#endif
+
 /* Row pin configuration
  *
  * Teensy
@@ -243,23 +354,8 @@ static matrix_row_t read_cols(uint8_t mcp23018_status, uint8_t row)
  * row: 0   1   2   3   4   5   6
  * pin: A0  A1  A2  A3  A4  A5  A6
  */
-static void unselect_rows(uint8_t mcp23018_status)
+static void unselect_rows(void)
 {
-    // unselect on mcp23018
-    if (mcp23018_status) { // if there was an error
-        // do nothing
-    } else {
-        // set all rows hi-Z : 1
-        uint8_t err = 0x20;
-        err = i2c_start(I2C_ADDR_WRITE);    if (err) goto out;
-        err = i2c_write(GPIOA);             if (err) goto out;
-        err = i2c_write( 0xFF
-                & ~(ergodox_left_led_3<<LEFT_LED_3_SHIFT)
-              );                            if (err) goto out;
-    out:
-        i2c_stop();
-    }
-
     // unselect on teensy
     // Hi-Z(DDR:0, PORT:0) to unselect
     DDRB  &= ~(1<<0 | 1<<1 | 1<<2 | 1<<3);
@@ -270,57 +366,38 @@ static void unselect_rows(uint8_t mcp23018_status)
     PORTC &= ~(1<<6);
 }
 
-static void select_row(uint8_t mcp23018_status, uint8_t row)
+static void select_row(uint8_t row)
 {
-    if (row < 7) {
-        // select on mcp23018
-        if (mcp23018_status) { // if there was an error
-            // do nothing
-        } else {
-            // set active row low  : 0
-            // set other rows hi-Z : 1
-            uint8_t err = 0x20;
-            err = i2c_start(I2C_ADDR_WRITE);        if (err) goto out;
-            err = i2c_write(GPIOA);                 if (err) goto out;
-            err = i2c_write( 0xFF & ~(1<<row) 
-                    & ~(ergodox_left_led_3<<LEFT_LED_3_SHIFT)
-                  );                                if (err) goto out;
-        out:
-            i2c_stop();
-        }
-    } else {
-        // select on teensy
-        // Output low(DDR:1, PORT:0) to select
-        switch (row) {
-            case 7:
-                DDRB  |= (1<<0);
-                PORTB &= ~(1<<0);
-                break;
-            case 8:
-                DDRB  |= (1<<1);
-                PORTB &= ~(1<<1);
-                break;
-            case 9:
-                DDRB  |= (1<<2);
-                PORTB &= ~(1<<2);
-                break;
-            case 10:
-                DDRB  |= (1<<3);
-                PORTB &= ~(1<<3);
-                break;
-            case 11:
-                DDRD  |= (1<<2);
-                PORTD &= ~(1<<3);
-                break;
-            case 12:
-                DDRD  |= (1<<3);
-                PORTD &= ~(1<<3);
-                break;
-            case 13:
-                DDRC  |= (1<<6);
-                PORTC &= ~(1<<6);
-                break;
-        }
+    // select on teensy
+    // Output low(DDR:1, PORT:0) to select
+    switch (row) {
+        case 7:
+            DDRB  |= (1<<0);
+            PORTB &= ~(1<<0);
+            break;
+        case 8:
+            DDRB  |= (1<<1);
+            PORTB &= ~(1<<1);
+            break;
+        case 9:
+            DDRB  |= (1<<2);
+            PORTB &= ~(1<<2);
+            break;
+        case 10:
+            DDRB  |= (1<<3);
+            PORTB &= ~(1<<3);
+            break;
+        case 11:
+            DDRD  |= (1<<2);
+            PORTD &= ~(1<<3);
+            break;
+        case 12:
+            DDRD  |= (1<<3);
+            PORTD &= ~(1<<3);
+            break;
+        case 13:
+            DDRC  |= (1<<6);
+            PORTC &= ~(1<<6);
+            break;
     }
 }
-
@@ -0,0 +1,125 @@
+/*
+Copyright 2013 Jun Wako <wakojun@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/twi.h>
+#include "twi_async.h"
+
+
+static twi_xfer_t *queue[TWI_QUEUE_SIZE];
+static volatile uint8_t head = 0;   // running transfer
+static volatile uint8_t tail = 0;
+static uint8_t pos = 0;             // bytes done in running transfer
+
+#define QUEUE_NEXT(i)   (((i) + 1) & (TWI_QUEUE_SIZE - 1))
+#define TWCR_NEXT       ((1<<TWINT) | (1<<TWEN) | (1<<TWIE))
+
+
+bool twi_async_submit(twi_xfer_t *xfer)
+{
+    bool ok = false;
+    xfer->status = TWI_PENDING;
+
+    uint8_t sreg = SREG;
+    cli();
+    if (QUEUE_NEXT(tail) != head) {
+        bool idle = (head == tail);
+        queue[tail] = xfer;
+        tail = QUEUE_NEXT(tail);
+        if (idle) {
+            // wait for STOP of last transfer
+            while (TWCR & (1<<TWSTO)) ;
+            pos = 0;
+            TWCR = TWCR_NEXT | (1<<TWSTA);
+        }
+        ok = true;
+    }
+    SREG = sreg;
+    return ok;
+}
+
+bool twi_async_busy(void)
+{
+    return head != tail;
+}
+
+void twi_async_abort(void)
+{
+    uint8_t sreg = SREG;
+    cli();
+    while (head != tail) {
+        queue[head]->status = TWI_ERROR;
+        head = QUEUE_NEXT(head);
+    }
+    // reset TWI; twimaster.c enables it again
+    TWCR = 0;
+    SREG = sreg;
+}
+
+ISR(TWI_vect)
+{
+    twi_xfer_t *x = queue[head];
+
+    switch (TW_STATUS) {
+        case TW_START:
+        case TW_REP_START:
+            TWDR = (x->addr<<1) | (pos < x->wlen ? TW_WRITE : TW_READ);
+            TWCR = TWCR_NEXT;
+            return;
+        case TW_MT_SLA_ACK:
+        case TW_MT_DATA_ACK:
+            if (pos < x->wlen) {
+                TWDR = x->wbuf[pos++];
+                TWCR = TWCR_NEXT;
+                return;
+            }
+            if (x->rlen) {
+                // repeated start to read
+                TWCR = TWCR_NEXT | (1<<TWSTA);
+                return;
+            }
+            x->status = TWI_DONE;
+            break;
+        case TW_MR_DATA_ACK:
+            x->rbuf[pos++ - x->wlen] = TWDR;
+            // fall through
+        case TW_MR_SLA_ACK:
+            // ACK but last byte
+            TWCR = TWCR_NEXT | (pos + 1 < x->wlen + x->rlen ? (1<<TWEA) : 0);
+            return;
+        case TW_MR_DATA_NACK:
+            x->rbuf[pos++ - x->wlen] = TWDR;
+            x->status = TWI_DONE;
+            break;
+        default:
+            // NACK, arbitration lost or bus error
+            x->status = TWI_ERROR;
+            break;
+    }
+
+    // STOP and START next transfer
+    head = QUEUE_NEXT(head);
+    pos = 0;
+    if (head != tail) {
+        TWCR = TWCR_NEXT | (1<<TWSTO) | (1<<TWSTA);
+    } else {
+        TWCR = (1<<TWINT) | (1<<TWEN) | (1<<TWSTO);
+    }
+}
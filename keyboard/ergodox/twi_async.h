@@ -0,0 +1,61 @@
+/*
+Copyright 2013 Jun Wako <wakojun@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TWI_ASYNC_H
+#define TWI_ASYNC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/*
+ * Interrupt driven I2C master
+ *
+ * Transfers are queued and run by TWI interrupt while CPU does other work.
+ * A transfer writes wlen bytes and then reads rlen bytes after repeated start.
+ * Bus clock is set by i2c_init() of twimaster.c; don't call i2c_*() while
+ * twi_async_busy().
+ */
+#ifndef TWI_QUEUE_SIZE
+#   define TWI_QUEUE_SIZE   8       // power of 2
+#endif
+
+#define TWI_XFER_WMAX       2
+#define TWI_XFER_RMAX       2
+
+/* transfer status */
+#define TWI_PENDING         0
+#define TWI_DONE            1
+#define TWI_ERROR           2
+
+typedef struct {
+    uint8_t addr;                   // 7-bit slave address
+    uint8_t wlen;
+    uint8_t rlen;
+    uint8_t wbuf[TWI_XFER_WMAX];
+    uint8_t rbuf[TWI_XFER_RMAX];
+    volatile uint8_t status;
+} twi_xfer_t;
+
+/* queue a transfer; returns false when queue is full */
+bool twi_async_submit(twi_xfer_t *xfer);
+/* whether queued transfers are left */
+bool twi_async_busy(void);
+/* stop bus and fail all queued transfers */
+void twi_async_abort(void);
+
+#endif
@@ -31,10 +31,18 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define MATRIX_ROWS 5
 #define MATRIX_COLS 14
 
+/* matrix pins for common/matrix_pins.c */
+#define MATRIX_ROW_PINS { MATRIX_PIN(D, 0), MATRIX_PIN(D, 1), MATRIX_PIN(D, 2), MATRIX_PIN(D, 3), \
+                          MATRIX_PIN(D, 5) }
+#define MATRIX_COL_PINS { MATRIX_PIN(F, 0), MATRIX_PIN(F, 1), MATRIX_PIN(E, 6), MATRIX_PIN(C, 7), \
+                          MATRIX_PIN(C, 6), MATRIX_PIN(B, 6), MATRIX_PIN(D, 4), MATRIX_PIN(B, 1), \
+                          MATRIX_PIN(B, 0), MATRIX_PIN(B, 5), MATRIX_PIN(B, 4), MATRIX_PIN(D, 7), \
+                          MATRIX_PIN(D, 6), MATRIX_PIN(B, 3) }
+
 /* define if matrix has ghost */
 //#define MATRIX_HAS_GHOST
 
-/* Set 0 if debouncing isn't needed */
+/* key release debounce time in ms. Set 0 if debouncing isn't needed */
 #define DEBOUNCE    5
 
 /* Mechanical locking support. Use KC_LCAP, KC_LNUM or KC_LSCR instead in keymap */
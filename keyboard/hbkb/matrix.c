@@ -23,6 +23,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "debug.h"
 #include "util.h"
 #include "matrix.h"
+#include "debounce.h"
+#include "matrix_settle.h"
 
 
 /*
@@ -32,21 +34,20 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
  *   COL: PD0-7
  *   ROW: PB0-7, PF4-7
  */
-#ifndef DEBOUNCE
-#   define DEBOUNCE	10
-#endif
-static uint8_t debouncing = DEBOUNCE;
-
 /* matrix state(1:on, 0:off) */
 static matrix_row_t matrix[MATRIX_ROWS];
-static matrix_row_t matrix_debouncing[MATRIX_ROWS];
 
 #ifdef MATRIX_HAS_GHOST
 static bool matrix_has_ghost_in_row(uint8_t row);
 #endif
+static void init_cols(void);
 static matrix_row_t read_cols(void);
 static void unselect_rows(void);
 static void select_row(uint8_t row);
+#ifdef MATRIX_SETTLE_CALIBRATE
+static void drive_cols(void);
+static bool cols_active(void);
+#endif
 
 
 inline
@@ -70,56 +71,41 @@ void matrix_init(void)
     // initialize rows
     unselect_rows();
 
-    // initialize columns to input with pull-up(DDR:0, PORT:1)
-    DDRD = 0x00;
-    PORTD = 0xFF;
+    // initialize columns
+    init_cols();
+#ifdef MATRIX_SETTLE_CALIBRATE
+    matrix_settle_calibrate(drive_cols, init_cols, cols_active);
+#endif
 
     // initialize matrix state: all keys off
     for (uint8_t i=0; i < MATRIX_ROWS; i++) {
         matrix[i] = 0;
-        matrix_debouncing[i] = 0;
     }
+    debounce_init();
 }
 
 uint8_t matrix_scan(void)
 {
     for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
         select_row(i);
-        _delay_us(30);  // without this wait read unstable value.
+        matrix_settle_wait();
         matrix_row_t cols = read_cols();
-        if (matrix_debouncing[i] != cols) {
-            matrix_debouncing[i] = cols;
-            if (debouncing) {
-                debug("bounce!: "); debug_hex(debouncing); debug("\n");
-            }
-            debouncing = DEBOUNCE;
-        }
+        debounce_row(i, cols, &matrix[i]);
         unselect_rows();
     }
 
-    if (debouncing) {
-        if (--debouncing) {
-            _delay_ms(1);
-        } else {
-            for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
-                matrix[i] = matrix_debouncing[i];
-            }
-        }
-    }
-
     return 1;
 }
 
 bool matrix_is_modified(void)
 {
-    if (debouncing) return false;
     return true;
 }
 
 inline
 bool matrix_is_on(uint8_t row, uint8_t col)
 {
-    return (matrix[row] & ((matrix_row_t)1<<col));
+    return (matrix[row] & MATRIX_ROW_BIT(col));
 }
 
 inline
@@ -130,10 +116,10 @@ matrix_row_t matrix_get_row(uint8_t row)
 
 void matrix_print(void)
 {
-    print("\nr/c 01234567\n");
+    print("\n" MATRIX_ROW_HEADER "\n");
     for (uint8_t row = 0; row < matrix_rows(); row++) {
         phex(row); print(": ");
-        pbin_reverse(matrix_get_row(row));
+        MATRIX_ROW_PRINT(matrix_get_row(row));
 #ifdef MATRIX_HAS_GHOST
         if (matrix_has_ghost_in_row(row)) {
             print(" <ghost");
@@ -148,7 +134,7 @@ inline
 static bool matrix_has_ghost_in_row(uint8_t row)
 {
     // no ghost exists in case less than 2 keys on
-    if (((matrix[row] - 1) & matrix[row]) == 0)
+    if (MATRIX_ROW_SINGLE(matrix[row]))
         return false;
 
     // ghost exists in case same state as other row
@@ -160,6 +146,27 @@ static bool matrix_has_ghost_in_row(uint8_t row)
 }
 #endif
 
+static void init_cols(void)
+{
+    // Input with pull-up(DDR:0, PORT:1)
+    DDRD = 0x00;
+    PORTD = 0xFF;
+}
+
+#ifdef MATRIX_SETTLE_CALIBRATE
+static void drive_cols(void)
+{
+    // Output low(DDR:1, PORT:0)
+    PORTD = 0x00;
+    DDRD = 0xFF;
+}
+
+static bool cols_active(void)
+{
+    return read_cols();
+}
+#endif
+
 inline
 static matrix_row_t read_cols(void)
 {
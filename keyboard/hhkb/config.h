@@ -31,6 +31,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define MATRIX_ROWS 8
 #define MATRIX_COLS 8
 
+/* measure recovery time of each key at startup instead of 150us(TMK Alt Controller) */
+#if defined(__AVR_ATmega32U4__)
+#   define HHKB_SCAN_CALIBRATE
+#endif
+
 
 /* key combination for command */
 #define IS_COMMAND() (keyboard_report->mods == (MOD_BIT(KC_LSHIFT) | MOD_BIT(KC_RSHIFT))) 
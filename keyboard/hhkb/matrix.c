@@ -28,6 +28,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "util.h"
 #include "timer.h"
 #include "matrix.h"
+#include "keycode.h"
+#include "command.h"
+#ifdef PROTOCOL_IWRAP
+#include "iwrap.h"
+#endif
 
 
 // Timer resolution check
@@ -159,6 +164,115 @@ static matrix_row_t _matrix1[MATRIX_ROWS];
 #endif
 
 
+/* Scan order
+ *
+ * Keys are scanned along diagonals so that each key is on a row and a column
+ * different from previous key. Next key is selected as soon as a key is read
+ * and its select settle time(40us) runs in recovery time(150us) of the key.
+ */
+#if (MATRIX_ROWS != 8 || MATRIX_COLS != 8)
+#   error "HHKB scan order needs 8x8 matrix"
+#endif
+#define SCAN_KEYS       (MATRIX_ROWS * MATRIX_COLS)
+#define SCAN_ROW(k)     ((k) & 0x07)
+#define SCAN_COL(k)     (((k) + ((k)>>3)) & 0x07)
+
+// wait from previous key to read in 5us unit
+#define WAIT_SETTLE     (40/5)
+#define WAIT_RECOVERY   (150/5)
+#define WAIT_MARGIN     (10/5)
+
+#ifdef HHKB_SCAN_CALIBRATE
+// wait of each key after previous key in scan order, measured at init
+static uint8_t scan_wait[SCAN_KEYS];
+static void scan_calibrate(void);
+#endif
+
+#define KEY_READ_OFF        0
+#define KEY_READ_ON         1
+#define KEY_READ_INVALID    2
+
+// retries of a key read discarded by interrupt
+#define KEY_READ_RETRY      3
+// key reads discarded by interrupt
+static uint16_t read_discard = 0;
+// keys left in previous state after all retries are discarded
+static uint16_t read_lost = 0;
+
+
+static inline void wait_5us(uint8_t n)
+{
+    while (n--) _delay_us(5);
+}
+
+/* read state of selected key */
+static uint8_t key_read(bool prev)
+{
+    uint8_t state;
+
+    // Not sure this is needed. This just emulates HHKB controller's behaviour.
+    if (prev) {
+        KEY_PREV_ON();
+    }
+    _delay_us(7);
+
+    // NOTE: KEY_STATE is valid only in 20us after KEY_ENABLE.
+    // If V-USB interrupts in this section we could lose 40us or so
+    // and would read invalid value from KEY_STATE.
+    // Timer tick is masked and kept pending here; only USB interrupt
+    // can break this section.
+    uint8_t timsk = TIMSK0;
+    TIMSK0 &= ~(1<<OCIE0A);
+    uint8_t last = TIMER_RAW;
+
+    KEY_ENABLE();
+
+    // Wait for KEY_STATE outputs its value.
+    // 1us was ok on one HHKB, but not worked on another.
+    // no   wait doesn't work on Teensy++ with pro(1us works)
+    // no   wait does    work on tmk PCB(8MHz) with pro2
+    // 1us  wait does    work on both of above
+    // 1us  wait doesn't work on tmk(16MHz)
+    // 5us  wait does    work on tmk(16MHz)
+    // 5us  wait does    work on tmk(16MHz/2)
+    // 5us  wait does    work on tmk(8MHz)
+    // 10us wait does    work on Teensy++ with pro
+    // 10us wait does    work on 328p+iwrap with pro
+    // 10us wait doesn't work on tmk PCB(8MHz) with pro2(very lagged scan)
+    _delay_us(5);
+
+    state = KEY_STATE() ? KEY_READ_OFF : KEY_READ_ON;
+
+    // Ignore if this code region execution time elapses more than 20us.
+    // MEMO: 20[us] * (TIMER_RAW_FREQ / 1000000)[count per us]
+    // MEMO: then change above using this rule: a/(b/c) = a*1/(b/c) = a*(c/b)
+    if (TIMER_DIFF_RAW(TIMER_RAW, last) > 20/(1000000/TIMER_RAW_FREQ)) {
+        state = KEY_READ_INVALID;
+    }
+    TIMSK0 = timsk;
+
+    KEY_PREV_OFF();
+    KEY_UNABLE();
+    // NOTE: KEY_STATE keep its state in 20us after KEY_ENABLE.
+    // This takes 25us or more to make sure KEY_STATE returns to idle state.
+    return state;
+}
+
+/* wait before reading next key after a key on prev_row/prev_col */
+static inline uint8_t scan_wait_next(uint8_t next, uint8_t prev_row, uint8_t prev_col)
+{
+#ifdef HHKB_SCAN_CALIBRATE
+    // keys held on the column just strobed may leave charge on sense line
+    // of next row; it is not measured at init and full recovery is used.
+    if ((matrix[prev_row] | matrix[SCAN_ROW(next)]) & MATRIX_ROW_BIT(prev_col))
+        return WAIT_RECOVERY;
+    return scan_wait[next];
+#else
+    return WAIT_RECOVERY;
+#endif
+}
+
+
 inline
 uint8_t matrix_rows(void)
 {
@@ -179,78 +293,106 @@ void matrix_init(void)
 #endif
 
     KEY_INIT();
+#ifdef HHKB_SCAN_CALIBRATE
+    scan_calibrate();
+#endif
 
     // initialize matrix state: all keys off
     for (uint8_t i=0; i < MATRIX_ROWS; i++) _matrix0[i] = 0x00;
     for (uint8_t i=0; i < MATRIX_ROWS; i++) _matrix1[i] = 0x00;
     matrix = _matrix0;
     matrix_prev = _matrix1;
+    matrix_dirty_mark(MATRIX_DIRTY_ALL);
 }
 
 uint8_t matrix_scan(void)
 {
-    uint8_t *tmp;
+    matrix_row_t *tmp;
 
     tmp = matrix_prev;
     matrix_prev = matrix;
     matrix = tmp;
+    // key read invalid keeps previous state
+    for (uint8_t i = 0; i < MATRIX_ROWS; i++) matrix[i] = matrix_prev[i];
 
     KEY_POWER_ON();
+    KEY_SELECT(SCAN_ROW(0), SCAN_COL(0));
+    // last key of previous scan may be still in recovery
+    uint8_t wait = WAIT_RECOVERY;
+    for (uint8_t k = 0; k < SCAN_KEYS; k++) {
+        uint8_t row = SCAN_ROW(k);
+        uint8_t col = SCAN_COL(k);
+        wait_5us(wait);
+
+        uint8_t state;
+        for (uint8_t retry = 0; ; retry++) {
+            state = key_read(matrix_prev[row] & MATRIX_ROW_BIT(col));
+            if (state != KEY_READ_INVALID) break;
+
+            if (read_discard < 0xFFFF) read_discard++;
+            if (retry == KEY_READ_RETRY) {
+                if (read_lost < 0xFFFF) read_lost++;
+                break;
+            }
+            // read the key again after its recovery
+            wait_5us(WAIT_RECOVERY);
+        }
+        if (state == KEY_READ_ON) {
+            matrix[row] |= MATRIX_ROW_BIT(col);
+        } else if (state == KEY_READ_OFF) {
+            matrix[row] &= ~MATRIX_ROW_BIT(col);
+        }
+
+        if (k + 1 < SCAN_KEYS) {
+            KEY_SELECT(SCAN_ROW(k + 1), SCAN_COL(k + 1));
+            wait = scan_wait_next(k + 1, row, col);
+        }
+    }
+    KEY_POWER_OFF();
+
     for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
-        for (uint8_t col = 0; col < MATRIX_COLS; col++) {
-            KEY_SELECT(row, col);
-            _delay_us(40);
+        if (matrix[row] != matrix_prev[row]) {
+            matrix_dirty_mark(MATRIX_DIRTY_ROW(row));
+        }
+    }
+    return 1;
+}
 
-            // Not sure this is needed. This just emulates HHKB controller's behaviour.
-            if (matrix_prev[row] & (1<<col)) {
-                KEY_PREV_ON();
-            }
-            _delay_us(7);
-
-            // NOTE: KEY_STATE is valid only in 20us after KEY_ENABLE.
-            // If V-USB interrupts in this section we could lose 40us or so
-            // and would read invalid value from KEY_STATE.
-            uint8_t last = TIMER_RAW;
-
-            KEY_ENABLE();
-
-            // Wait for KEY_STATE outputs its value.
-            // 1us was ok on one HHKB, but not worked on another.
-            // no   wait doesn't work on Teensy++ with pro(1us works)
-            // no   wait does    work on tmk PCB(8MHz) with pro2
-            // 1us  wait does    work on both of above
-            // 1us  wait doesn't work on tmk(16MHz)
-            // 5us  wait does    work on tmk(16MHz)
-            // 5us  wait does    work on tmk(16MHz/2)
-            // 5us  wait does    work on tmk(8MHz)
-            // 10us wait does    work on Teensy++ with pro
-            // 10us wait does    work on 328p+iwrap with pro
-            // 10us wait doesn't work on tmk PCB(8MHz) with pro2(very lagged scan)
-            _delay_us(5);
-
-            if (KEY_STATE()) {
-                matrix[row] &= ~(1<<col);
-            } else {
-                matrix[row] |= (1<<col);
-            }
+#ifdef HHKB_SCAN_CALIBRATE
+/* whether key k reads off 8 times in row with wait w after previous key */
+static bool scan_calibrate_probe(uint8_t k, uint8_t w)
+{
+    uint8_t prev = (k + SCAN_KEYS - 1) % SCAN_KEYS;
+    for (uint8_t i = 0; i < 8; i++) {
+        KEY_SELECT(SCAN_ROW(prev), SCAN_COL(prev));
+        wait_5us(WAIT_RECOVERY);
+        key_read(false);
+        KEY_SELECT(SCAN_ROW(k), SCAN_COL(k));
+        wait_5us(w);
+        if (key_read(false) != KEY_READ_OFF)
+            return false;
+    }
+    return true;
+}
 
-            // Ignore if this code region execution time elapses more than 20us.
-            // MEMO: 20[us] * (TIMER_RAW_FREQ / 1000000)[count per us]
-            // MEMO: then change above using this rule: a/(b/c) = a*1/(b/c) = a*(c/b)
-            if (TIMER_DIFF_RAW(TIMER_RAW, last) > 20/(1000000/TIMER_RAW_FREQ)) {
-                matrix[row] = matrix_prev[row];
+/* Measure shortest wait of each key after previous key in scan order and
+ * give it margin. Keys held at init keep full recovery time.
+ */
+static void scan_calibrate(void)
+{
+    KEY_POWER_ON();
+    for (uint8_t k = 0; k < SCAN_KEYS; k++) {
+        scan_wait[k] = WAIT_RECOVERY;
+        for (uint8_t w = WAIT_SETTLE; w < WAIT_RECOVERY - WAIT_MARGIN; w++) {
+            if (scan_calibrate_probe(k, w)) {
+                scan_wait[k] = w + WAIT_MARGIN;
+                break;
             }
-
-            KEY_PREV_OFF();
-            KEY_UNABLE();
-            // NOTE: KEY_STATE keep its state in 20us after KEY_ENABLE.
-            // This takes 25us or more to make sure KEY_STATE returns to idle state.
-            _delay_us(150);
         }
     }
     KEY_POWER_OFF();
-    return 1;
 }
+#endif
 
 bool matrix_is_modified(void)
 {
@@ -270,7 +412,7 @@ bool matrix_has_ghost(void)
 inline
 bool matrix_is_on(uint8_t row, uint8_t col)
 {
-    return (matrix[row] & (1<<col));
+    return (matrix[row] & MATRIX_ROW_BIT(col));
 }
 
 inline
@@ -281,8 +423,45 @@ matrix_row_t matrix_get_row(uint8_t row)
 
 void matrix_print(void)
 {
-    print("\nr/c 01234567\n");
+    print("\n" MATRIX_ROW_HEADER "\n");
     for (uint8_t row = 0; row < matrix_rows(); row++) {
-        xprintf("%02X: %08b\n", row, bitrev(matrix_get_row(row)));
+        xprintf("%02X: ", row);
+        MATRIX_ROW_PRINT(matrix_get_row(row));
+        print("\n");
+    }
+}
+
+#ifdef PROTOCOL_IWRAP
+// iWRAP has its own command_extra() and calls this first
+bool iwrap_command_extra(uint8_t code)
+#else
+bool command_extra(uint8_t code)
+#endif
+{
+    switch (code) {
+        case KC_H:
+        case KC_SLASH: /* ? */
+            print("\n\n----- HHKB Help -----\n");
+            print("p:	print discarded key reads and clear\n");
+            return false;
+        case KC_P:
+            xprintf("\nkey read discard: %u lost: %u\n", read_discard, read_lost);
+            read_discard = 0;
+            read_lost = 0;
+#ifdef HHKB_SCAN_CALIBRATE
+            print("wait(us):\n");
+            for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+                xprintf("%02X:", row);
+                for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+                    // scan order of the key
+                    xprintf(" %3u", scan_wait[row + (((col - row) & 0x07)<<3)] * 5);
+                }
+                print("\n");
+            }
+#endif
+            break;
+        default:
+            return false;
     }
+    return true;
 }
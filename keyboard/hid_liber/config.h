@@ -38,7 +38,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 /* define if matrix has ghost */
 //#define MATRIX_HAS_GHOST
 
-/* Set 0 if need no debouncing */
+/* key release debounce time in ms. Set 0 if debouncing isn't needed */
 #define DEBOUNCE    8
 
 /* key combination for command */
@@ -16,16 +16,13 @@
 #include "debug.h"
 #include "util.h"
 #include "matrix.h"
+#include "debounce.h"
 
 
-#ifndef DEBOUNCE
-#   define DEBOUNCE 0
-#endif
-static uint8_t debouncing = DEBOUNCE;
-
 // bit array of key state(1:on, 0:off)
 static matrix_row_t matrix[MATRIX_ROWS];
-static matrix_row_t matrix_debouncing[MATRIX_ROWS];
+// raw state read from switch
+static matrix_row_t matrix_raw[MATRIX_ROWS];
 
 
 #define _DDRA (uint8_t *const)&DDRA
@@ -35,13 +32,6 @@ static matrix_row_t matrix_debouncing[MATRIX_ROWS];
 #define _DDRE (uint8_t *const)&DDRE
 #define _DDRF (uint8_t *const)&DDRF
 
-#define _PINA (uint8_t *const)&PINA
-#define _PINB (uint8_t *const)&PINB
-#define _PINC (uint8_t *const)&PINC
-#define _PIND (uint8_t *const)&PIND
-#define _PINE (uint8_t *const)&PINE
-#define _PINF (uint8_t *const)&PINF
-
 #define _PORTA (uint8_t *const)&PORTA
 #define _PORTB (uint8_t *const)&PORTB
 #define _PORTC (uint8_t *const)&PORTC
@@ -73,13 +63,6 @@ uint8_t *const row_port[MATRIX_ROWS] = {
           _PORTD, _PORTD, _PORTD, _PORTD, _PORTD, _PORTD, _PORTD, _PORTD,
           _PORTF, _PORTF,                 _PORTF, _PORTF, _PORTF, _PORTF};
 
-static
-uint8_t *const row_pin[MATRIX_ROWS] = {
-                                           _PINB,                  _PINB,
-                                                           _PINC,  _PINC,
-           _PIND,  _PIND,  _PIND,  _PIND,  _PIND,  _PIND,  _PIND,  _PIND,
-           _PINF,  _PINF,                  _PINF,  _PINF,  _PINF,  _PINF};
-
 static
 const uint8_t row_bit[MATRIX_ROWS] = {
                                            _BIT4,                  _BIT7,
@@ -148,37 +131,45 @@ void matrix_init(void)
     // initialize matrix state: all keys off
     for (uint8_t i=0; i < MATRIX_ROWS; i++) {
         matrix[i] = 0;
-        matrix_debouncing[i] = 0;
+        matrix_raw[i] = 0;
     }
+    debounce_init();
 }
 
 uint8_t matrix_scan(void)
 {
+    /* Rows of each column are read as port bytes and transposed into row
+     * words 8 columns at once.
+     *   a: rows 0-3 on PB4,PB7,PC6,PC7 in bit0-3, rows 14-17 on PF4-7 in bit4-7
+     *   d: rows 4-11 on PD0-7
+     *   f: rows 12-13 on PF0-1
+     */
+    uint8_t a[8], d[8], f[8];
     for (uint8_t col = 0; col < MATRIX_COLS; col++) {  // 0-7
         pull_column(col);   // output hi on theline
         _delay_us(5);       // without this wait it won't read stable value.
-        for (uint8_t row = 0; row < MATRIX_ROWS; row++) {  // 0-17
-            bool prev_bit = matrix_debouncing[row] & (1<<col);
-            bool curr_bit = *row_pin[row] & row_bit[row];
-            if (prev_bit != curr_bit) {
-                matrix_debouncing[row] ^= ((matrix_row_t)1<<col);
-                if (debouncing) {
-                    dprintf("bounce!: %02X\n", debouncing);
-                }
-                debouncing = DEBOUNCE;
-            }
-        }
+        uint8_t pinb = PINB, pinc = PINC, pinf = PINF;
+        a[col] = (pinb>>4 & 0x01) | (pinb>>6 & 0x02) | (pinc>>4 & 0x0C) | (pinf & 0xF0);
+        d[col] = PIND;
+        f[col] = pinf & 0x03;
         release_column(col);
     }
+    bittranspose(a);
+    bittranspose(d);
+    bittranspose(f);
 
-    if (debouncing) {
-        if (--debouncing) {
-            _delay_ms(1);
-        } else {
-            for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
-                matrix[i] = matrix_debouncing[i];
-            }
-        }
+    for (uint8_t i = 0; i < 4; i++) {
+        matrix_raw[i]      = a[i];
+        matrix_raw[14 + i] = a[4 + i];
+    }
+    for (uint8_t i = 0; i < 8; i++) {
+        matrix_raw[4 + i] = d[i];
+    }
+    matrix_raw[12] = f[0];
+    matrix_raw[13] = f[1];
+
+    for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
+        debounce_row(i, matrix_raw[i], &matrix[i]);
     }
 
     return 1;
@@ -199,7 +190,7 @@ bool matrix_has_ghost(void)
 inline
 bool matrix_is_on(uint8_t row, uint8_t col)
 {
-    return (matrix[row] & ((matrix_row_t)1<<col));
+    return (matrix[row] & MATRIX_ROW_BIT(col));
 }
 
 inline
@@ -210,10 +201,10 @@ matrix_row_t matrix_get_row(uint8_t row)
 
 void matrix_print(void)
 {
-    print("\nr/c 01234567\n");
+    print("\n" MATRIX_ROW_HEADER "\n");
     for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
         phex(row); print(": ");
-        pbin_reverse(matrix_get_row(row));
+        MATRIX_ROW_PRINT(matrix_get_row(row));
         print("\n");
     }
 }
@@ -39,9 +39,12 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 /* define if matrix has ghost */
 //#define MATRIX_HAS_GHOST
 
-/* Set 0 if need no debouncing */
+/* key release debounce time in ms. Set 0 if debouncing isn't needed */
 #define DEBOUNCE    5
 
+/* wait in us after selecting column */
+#define MATRIX_SETTLE_US    3
+
 /* key combination for command */
 #define IS_COMMAND() ( \
     keyboard_report->mods == (MOD_BIT(KC_LSHIFT) | MOD_BIT(KC_RSHIFT)) \
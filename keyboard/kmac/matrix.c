@@ -23,20 +23,22 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "debug.h"
 #include "util.h"
 #include "matrix.h"
+#include "debounce.h"
+#include "matrix_settle.h"
 
 
-#ifndef DEBOUNCE
-#   define DEBOUNCE	0
-#endif
-static uint8_t debouncing = DEBOUNCE;
-
 /* matrix state(1:on, 0:off) */
 static matrix_row_t matrix[MATRIX_ROWS];
-static matrix_row_t matrix_debouncing[MATRIX_ROWS];
+// raw state read from switch
+static matrix_row_t matrix_raw[MATRIX_ROWS];
 
 static uint8_t read_rows(void);
 static uint8_t read_caps(void);
 static void init_rows(void);
+#ifdef MATRIX_SETTLE_CALIBRATE
+static void drive_rows(void);
+static bool rows_active(void);
+#endif
 static void unselect_cols(void);
 static void select_col(uint8_t col);
 
@@ -56,45 +58,38 @@ void matrix_init(void)
 {
     unselect_cols();
     init_rows();
+#ifdef MATRIX_SETTLE_CALIBRATE
+    matrix_settle_calibrate(drive_rows, init_rows, rows_active);
+#endif
     // initialize matrix state: all keys off
     for (uint8_t i=0; i < MATRIX_ROWS; i++)  {
         matrix[i] = 0;
-        matrix_debouncing[i] = 0;
+        matrix_raw[i] = 0;
     }
+    debounce_init();
 }
 
 uint8_t matrix_scan(void)
 {
+    // rows of each column, transposed into row words 8 columns at once
+    uint8_t cols[24] = { 0 };
     for (uint8_t col = 0; col < MATRIX_COLS; col++) {  // 0-16
         select_col(col);
-        _delay_us(3); // TODO: Determine the correct value needed here.
-        uint8_t rows = read_rows();
+        matrix_settle_wait();
+        cols[col] = read_rows();
         // Use the otherwise unused col: 0 row: 3 for caps lock.
         if(col == 0) {
-            rows |= read_caps();
-        }
-        for (uint8_t row = 0; row < MATRIX_ROWS; row++) {  // 0-5
-            bool prev_bit = matrix_debouncing[row] & ((matrix_row_t)1<<col);
-            bool curr_bit = rows & (1<<row);
-            if (prev_bit != curr_bit) {
-                matrix_debouncing[row] ^= ((matrix_row_t)1<<col);
-                if (debouncing) {
-                    dprint("bounce!: "); dprintf("%02X", debouncing); dprintln();
-                }
-                debouncing = DEBOUNCE;
-            }
+            cols[col] |= read_caps();
         }
         unselect_cols();
     }
+    bittranspose(&cols[0]);
+    bittranspose(&cols[8]);
+    bittranspose(&cols[16]);
 
-    if (debouncing) {
-        if (--debouncing) {
-            _delay_ms(1);
-        } else {
-            for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
-                matrix[i] = matrix_debouncing[i];
-            }
-        }
+    for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
+        matrix_raw[i] = cols[i] | (uint16_t)cols[8 + i]<<8 | (uint32_t)cols[16 + i]<<16;
+        debounce_row(i, matrix_raw[i], &matrix[i]);
     }
 
     return 1;
@@ -102,14 +97,13 @@ uint8_t matrix_scan(void)
 
 bool matrix_is_modified(void)
 {
-    if (debouncing) return false;
     return true;
 }
 
 inline
 bool matrix_is_on(uint8_t row, uint8_t col)
 {
-    return (matrix[row] & ((matrix_row_t)1<<col));
+    return (matrix[row] & MATRIX_ROW_BIT(col));
 }
 
 inline
@@ -120,9 +114,11 @@ matrix_row_t matrix_get_row(uint8_t row)
 
 void matrix_print(void)
 {
-    print("\nr/c 0123456789ABCDEF\n");
+    print("\n" MATRIX_ROW_HEADER "\n");
     for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
-        xprintf("%02X: %032lb\n", row, bitrev32(matrix_get_row(row)));
+        xprintf("%02X: ", row);
+        MATRIX_ROW_PRINT(matrix_get_row(row));
+        print("\n");
     }
 }
 
@@ -130,7 +126,7 @@ uint8_t matrix_key_count(void)
 {
     uint8_t count = 0;
     for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
-        count += bitpop32(matrix[i]);
+        count += MATRIX_ROW_BITPOP(matrix[i]);
     }
     return count;
 }
@@ -154,6 +150,22 @@ static void init_rows(void)
     PORTE |= (1<<2);
 }
 
+#ifdef MATRIX_SETTLE_CALIBRATE
+static void drive_rows(void)
+{
+    // Output high(DDR:1, PORT:1) as key is on
+    PORTD |= 0b00101111;
+    DDRD  |= 0b00101111;
+    PORTB |= (1<<7);
+    DDRB  |= (1<<7);
+}
+
+static bool rows_active(void)
+{
+    return read_rows();
+}
+#endif
+
 static uint8_t read_rows(void)
 {
     return (PIND&(1<<0) ? (1<<0) : 0) |
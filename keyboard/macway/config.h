@@ -33,12 +33,22 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define MATRIX_ROWS 9
 #define MATRIX_COLS 8
 
+/* matrix pins for common/matrix_pins.c */
+#define MATRIX_ROW_PINS { MATRIX_PIN(D, 0), MATRIX_PIN(D, 5), MATRIX_PIN(D, 7), MATRIX_PIN(F, 6), \
+                          MATRIX_PIN(D, 6), MATRIX_PIN(D, 1), MATRIX_PIN(D, 2), MATRIX_PIN(C, 6), \
+                          MATRIX_PIN(F, 7) }
+#define MATRIX_COL_PINS { MATRIX_PIN(B, 0), MATRIX_PIN(B, 1), MATRIX_PIN(B, 2), MATRIX_PIN(B, 3), \
+                          MATRIX_PIN(B, 4), MATRIX_PIN(B, 5), MATRIX_PIN(B, 6), MATRIX_PIN(B, 7) }
+
 /* define if matrix has ghost */
 #define MATRIX_HAS_GHOST
 
-/* Set 0 if need no debouncing */
+/* key release debounce time in ms. Set 0 if debouncing isn't needed */
 #define DEBOUNCE    5
 
+/* stop scan and sleep until key edge when no key is on */
+//#define MATRIX_IDLE_SLEEP
+
 /* legacy keymap support */
 #define USE_LEGACY_KEYMAP
 
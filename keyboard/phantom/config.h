@@ -36,9 +36,12 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 /* define if matrix has ghost */
 //#define MATRIX_HAS_GHOST
 
-/* Set 0 if need no debouncing */
+/* key release debounce time in ms. Set 0 if debouncing isn't needed */
 #define DEBOUNCE    7
 
+/* stop scan and sleep until key edge when no key is on */
+//#define MATRIX_IDLE_SLEEP
+
 /* Set LED brightness 0-255.
  * This have no effect if sleep LED is enabled. */
 #define LED_BRIGHTNESS  250
@@ -16,16 +16,13 @@
 #include "debug.h"
 #include "util.h"
 #include "matrix.h"
+#include "debounce.h"
 
 
-#ifndef DEBOUNCE
-#   define DEBOUNCE	0
-#endif
-static uint8_t debouncing = DEBOUNCE;
-
 // bit array of key state(1:on, 0:off)
 static matrix_row_t matrix[MATRIX_ROWS];
-static matrix_row_t matrix_debouncing[MATRIX_ROWS];
+// raw state read from switch
+static matrix_row_t matrix_raw[MATRIX_ROWS];
 
 static uint8_t read_rows(void);
 static void init_rows(void);
@@ -88,8 +85,9 @@ void matrix_init(void)
     // initialize matrix state: all keys off
     for (uint8_t i = 0; i < MATRIX_ROWS; i++)  {
         matrix[i] = 0;
-        matrix_debouncing[i] = 0;
+        matrix_raw[i] = 0;
     }
+    debounce_init();
 }
 
 uint8_t matrix_scan(void)
@@ -99,27 +97,17 @@ uint8_t matrix_scan(void)
         _delay_us(3);       // without this wait it won't read stable value.
         uint8_t rows = read_rows();
         for (uint8_t row = 0; row < MATRIX_ROWS; row++) {  // 0-5
-            bool prev_bit = matrix_debouncing[row] & ((matrix_row_t)1<<col);
+            bool prev_bit = matrix_raw[row] & MATRIX_ROW_BIT(col);
             bool curr_bit = rows & (1<<row);
             if (prev_bit != curr_bit) {
-                matrix_debouncing[row] ^= ((matrix_row_t)1<<col);
-                if (debouncing) {
-                    dprint("bounce!: "); dprintf("%02X", debouncing); dprintln();
-                }
-                debouncing = DEBOUNCE;
+                matrix_raw[row] ^= MATRIX_ROW_BIT(col);
             }
         }
         unselect_cols();
     }
 
-    if (debouncing) {
-        if (--debouncing) {
-            _delay_ms(1);
-        } else {
-            for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
-                matrix[i] = matrix_debouncing[i];
-            }
-        }
+    for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
+        debounce_row(i, matrix_raw[i], &matrix[i]);
     }
 
     return 1;
@@ -127,14 +115,13 @@ uint8_t matrix_scan(void)
 
 bool matrix_is_modified(void)
 {
-    if (debouncing) return false;
     return true;
 }
 
 inline
 bool matrix_is_on(uint8_t row, uint8_t col)
 {
-    return (matrix[row] & ((matrix_row_t)1<<col));
+    return (matrix[row] & MATRIX_ROW_BIT(col));
 }
 
 inline
@@ -145,9 +132,11 @@ matrix_row_t matrix_get_row(uint8_t row)
 
 void matrix_print(void)
 {
-    print("\nr/c 0123456789ABCDEF\n");
+    print("\n" MATRIX_ROW_HEADER "\n");
     for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
-        xprintf("%02X: %032lb\n", row, bitrev32(matrix_get_row(row)));
+        xprintf("%02X: ", row);
+        MATRIX_ROW_PRINT(matrix_get_row(row));
+        print("\n");
     }
 }
 
@@ -155,11 +144,35 @@ uint8_t matrix_key_count(void)
 {
     uint8_t count = 0;
     for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
-        count += bitpop32(matrix[i]);
+        count += MATRIX_ROW_BITPOP(matrix[i]);
     }
     return count;
 }
 
+#ifdef MATRIX_IDLE_SLEEP
+uint8_t matrix_idle_enter(void)
+{
+    if (!debounce_idle()) return 0;
+    for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
+        if (matrix[i]) return 0;
+    }
+
+    // select all columns: Output low(DDR:1, PORT:0)
+    PORTC &= ~0b11000000;
+    PORTD  = 0x00;
+    PORTE &= ~0b01000000;
+    PORTF &= ~0b11110011;
+    _delay_us(3);
+    // rows: PB5-0
+    return 0b00111111;
+}
+
+void matrix_idle_exit(void)
+{
+    unselect_cols();
+}
+#endif
+
 /* Row pin configuration
  * row: 0   1   2   3   4   5
  * pin: B5  B4  B3  B2  B1  B0
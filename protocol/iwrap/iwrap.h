@@ -46,4 +46,7 @@ bool iwrap_failed(void);
 uint8_t iwrap_connected(void);
 uint8_t iwrap_check_connection(void);
 
+/* keyboard specific command called before iWRAP commands, return false when not processed */
+bool iwrap_command_extra(uint8_t code);
+
 #endif
@@ -245,9 +245,15 @@ static bool console(void)
         }
 }
 
+bool iwrap_command_extra(uint8_t code) __attribute__ ((weak));
+bool iwrap_command_extra(uint8_t code)
+{
+    return false;
+}
+
 bool command_extra(uint8_t code)
 {
-    return console_command(key2asc(code));
+    return (iwrap_command_extra(code) || console_command(key2asc(code)));
 }
 
 static bool console_command(uint8_t c)
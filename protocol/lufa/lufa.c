@@ -48,6 +48,7 @@
 #include "sleep_led.h"
 #endif
 #include "suspend.h"
+#include "latency.h"
 
 #include "descriptor.h"
 #include "lufa.h"
@@ -173,7 +174,8 @@ void EVENT_USB_Device_WakeUp()
 #ifdef SLEEP_LED_ENABLE
     sleep_led_disable();
 #endif
-    led_set(host_keyboard_leds());
+    // restore LEDs in keyboard_task() instead of interrupt
+    host_keyboard_leds_changed();
 }
 
 void EVENT_USB_Device_StartOfFrame(void)
@@ -286,6 +288,7 @@ void EVENT_USB_Device_ControlRequest(void)
                           return;
                     }
                     keyboard_led_stats = Endpoint_Read_8();
+                    host_keyboard_leds_changed();
 
                     Endpoint_ClearOUT();
                     Endpoint_ClearStatusStage();
@@ -384,6 +387,7 @@ static void send_keyboard(report_keyboard_t *report)
 
     /* Finalize the stream transfer to send the last packet */
     Endpoint_ClearIN();
+    latency_mark(LATENCY_USB_SENT);
 
     keyboard_report_sent = *report;
 }
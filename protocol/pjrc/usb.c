@@ -662,7 +662,8 @@ ISR(USB_GEN_vect)
 #ifdef SLEEP_LED_ENABLE
             sleep_led_disable();
 #endif
-            led_set(host_keyboard_leds());
+            // restore LEDs in keyboard_task() instead of interrupt
+            host_keyboard_leds_changed();
 
             UDIEN |= (1<<SUSPE);
             UDIEN &= ~(1<<WAKEUPE);
@@ -914,6 +915,7 @@ ISR(USB_COM_vect)
 				if (bRequest == HID_SET_REPORT) {
 					usb_wait_receive_out();
 					usb_keyboard_leds = UEDATX;
+					host_keyboard_leds_changed();
 					usb_ack_out();
 					usb_send_in();
 					return;
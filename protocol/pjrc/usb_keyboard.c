@@ -29,6 +29,7 @@
 #include "debug.h"
 #include "util.h"
 #include "host.h"
+#include "latency.h"
 
 
 // protocol setting from the host.  We use exactly the same report
@@ -68,6 +69,7 @@ int8_t usb_keyboard_send_report(report_keyboard_t *report)
     }
 
     if (result) return result;
+    latency_mark(LATENCY_USB_SENT);
     usb_keyboard_idle_count = 0;
     usb_keyboard_print_report(report);
     return 0;
@@ -210,6 +210,7 @@ uchar usbFunctionWrite(uchar *data, uchar len)
             debug_hex(data[0]);
             debug("\n");
             vusb_keyboard_leds = data[0];
+            host_keyboard_leds_changed();
             last_req.len = 0;
             return 1;
             break;
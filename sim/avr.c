@@ -0,0 +1,103 @@
+/*
+Copyright 2013 Jun Wako <wakojun@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*
+ * Host simulator: AVR registers and EEPROM
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+#include <avr/io.h>
+#include <avr/eeprom.h>
+
+
+volatile uint8_t SREG;
+
+volatile uint8_t TCCR0A, TCCR0B, TCNT0, OCR0A, TIMSK0, TIFR0;
+volatile uint8_t TCCR1A, TCCR1B, TIMSK1, TIFR1;
+volatile uint16_t OCR1A, OCR1B, OCR1C, TCNT1, ICR1;
+volatile uint8_t TCCR3A, TCCR3B, TIMSK3, TIFR3;
+volatile uint16_t OCR3A, TCNT3;
+
+volatile uint8_t PINA, DDRA, PORTA;
+volatile uint8_t PINB, DDRB, PORTB;
+volatile uint8_t PINC, DDRC, PORTC;
+volatile uint8_t PIND, DDRD, PORTD;
+volatile uint8_t PINE, DDRE, PORTE;
+volatile uint8_t PINF, DDRF, PORTF;
+
+
+/* erased EEPROM reads 0xFF */
+#define EEPROM_SIZE 1024
+static uint8_t eeprom[EEPROM_SIZE];
+static bool eeprom_initialized = false;
+
+static uint8_t *eeprom_addr(const void *addr)
+{
+    if (!eeprom_initialized) {
+        memset(eeprom, 0xFF, sizeof(eeprom));
+        eeprom_initialized = true;
+    }
+    return &eeprom[(uintptr_t)addr % EEPROM_SIZE];
+}
+
+uint8_t eeprom_read_byte(const uint8_t *addr)
+{
+    return *eeprom_addr(addr);
+}
+
+uint16_t eeprom_read_word(const uint16_t *addr)
+{
+    uint8_t *p = eeprom_addr(addr);
+    return p[0] | (p[1] << 8);
+}
+
+void eeprom_write_byte(uint8_t *addr, uint8_t value)
+{
+    *eeprom_addr(addr) = value;
+}
+
+void eeprom_write_word(uint16_t *addr, uint16_t value)
+{
+    uint8_t *p = eeprom_addr(addr);
+    p[0] = value;
+    p[1] = value >> 8;
+}
+
+void eeprom_update_byte(uint8_t *addr, uint8_t value)
+{
+    eeprom_write_byte(addr, value);
+}
+
+void eeprom_update_word(uint16_t *addr, uint16_t value)
+{
+    eeprom_write_word(addr, value);
+}
+
+void eeprom_read_block(void *dst, const void *src, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        ((uint8_t *)dst)[i] = eeprom_read_byte((const uint8_t *)src + i);
+    }
+}
+
+void eeprom_update_block(const void *src, void *dst, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        eeprom_write_byte((uint8_t *)dst + i, ((const uint8_t *)src)[i]);
+    }
+}
@@ -0,0 +1,10 @@
+#ifndef SIM_AVR_INTERRUPT_H
+#define SIM_AVR_INTERRUPT_H
+
+/* interrupt handler is a plain function called by sim main loop */
+#define ISR(vector, ...)    void vector(void); void vector(void)
+#define ISR_NOBLOCK
+#define cli()
+#define sei()
+
+#endif
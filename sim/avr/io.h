@@ -0,0 +1,40 @@
+/*
+ * Host simulator: registers touched by common code are plain variables.
+ */
+#ifndef SIM_AVR_IO_H
+#define SIM_AVR_IO_H
+
+#include <stdint.h>
+
+#define _BV(bit)            (1 << (bit))
+#define _SFR_MEM_ADDR(sfr)  ((uint16_t)(uintptr_t)&(sfr))
+
+extern volatile uint8_t SREG;
+
+/* Timer0: 1ms system timer */
+extern volatile uint8_t TCCR0A, TCCR0B, TCNT0, OCR0A, TIMSK0, TIFR0;
+#define OCIE0A  1
+#define OCF0A   1
+
+/* Timer1: backlight and LED PWM */
+extern volatile uint8_t TCCR1A, TCCR1B, TIMSK1, TIFR1;
+extern volatile uint16_t OCR1A, OCR1B, OCR1C, TCNT1, ICR1;
+
+/* Timer3: MATRIX_SCAN_ISR */
+extern volatile uint8_t TCCR3A, TCCR3B, TIMSK3, TIFR3;
+extern volatile uint16_t OCR3A, TCNT3;
+#define TIMSK3  TIMSK3      // for #ifdef
+#define OCIE3A  1
+#define OCF3A   1
+#define WGM32   3
+#define CS31    1
+
+/* GPIO */
+extern volatile uint8_t PINA, DDRA, PORTA;
+extern volatile uint8_t PINB, DDRB, PORTB;
+extern volatile uint8_t PINC, DDRC, PORTC;
+extern volatile uint8_t PIND, DDRD, PORTD;
+extern volatile uint8_t PINE, DDRE, PORTE;
+extern volatile uint8_t PINF, DDRF, PORTF;
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef SIM_AVR_PGMSPACE_H
+#define SIM_AVR_PGMSPACE_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define PROGMEM
+#define PSTR(s)             (s)
+#define pgm_read_byte(p)    (*(const uint8_t *)(p))
+#define pgm_read_word(p)    (*(const uint16_t *)(p))
+#define pgm_read_dword(p)   (*(const uint32_t *)(p))
+#define memcpy_P(d, s, n)   memcpy(d, s, n)
+#define strlen_P(s)         strlen(s)
+
+#endif
@@ -0,0 +1,11 @@
+#ifndef SIM_AVR_WDT_H
+#define SIM_AVR_WDT_H
+
+#define WDTO_15MS   0
+#define WDTO_120MS  3
+#define WDTO_1S     6
+#define wdt_reset()
+#define wdt_enable(value)
+#define wdt_disable()
+
+#endif
@@ -0,0 +1,193 @@
+/*
+Copyright 2013 Jun Wako <wakojun@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*
+ * Debounce check and microbenchmark(common/debounce.c)
+ *
+ * Each line of corpus has name, raw key state and expected debounced state,
+ * one character per ms. Every pattern is played on all keys with different
+ * phase and scan rate, then debounce_row() cost per row is measured on the
+ * corpus and on idle matrix.
+ *
+ * usage: debounce_bench [-n scans] < bounce.txt
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "debounce.h"
+
+
+#define MAX_PATTERNS    64
+#define MAX_LEN         256
+#define PHASES          7
+
+#ifdef DEBOUNCE_VERTICAL_COUNTER
+#   define DEBOUNCE_NAME   "vertical counter"
+#else
+#   define DEBOUNCE_NAME   "per-key time"
+#endif
+
+typedef struct {
+    char name[32];
+    char raw[MAX_LEN];
+    char want[MAX_LEN];
+    int len;
+} pattern_t;
+
+static pattern_t patterns[MAX_PATTERNS];
+static int pattern_count = 0;
+static uint16_t now_ms = 0;
+static matrix_row_t matrix[MATRIX_ROWS];
+
+
+uint16_t timer_read(void)
+{
+    return now_ms;
+}
+
+static char state_at(const char *s, int len, int shift, int ms)
+{
+    int i = ms - shift;
+    if (i < 0) return '0';
+    if (i >= len) return s[len - 1];
+    return s[i];
+}
+
+static void read_corpus(FILE *fp)
+{
+    char line[MAX_LEN * 2 + 64];
+    while (fgets(line, sizeof(line), fp)) {
+        pattern_t *p = &patterns[pattern_count];
+        if (line[0] == '#' || line[0] == '\n') continue;
+        if (sscanf(line, "%31s %255s %255s", p->name, p->raw, p->want) != 3) continue;
+        p->len = strlen(p->raw);
+        if (p->len != (int)strlen(p->want)) {
+            fprintf(stderr, "%s: length mismatch\n", p->name);
+            continue;
+        }
+        if (++pattern_count == MAX_PATTERNS) break;
+    }
+}
+
+/* play pattern on all keys: key k is delayed by k % PHASES ms */
+static bool check(const pattern_t *p, int scans_per_ms)
+{
+    int total = p->len + PHASES;
+    bool ok = true;
+
+    now_ms = 1000;
+    debounce_init();
+    for (uint8_t r = 0; r < MATRIX_ROWS; r++) matrix[r] = 0;
+
+    for (int ms = 0; ms < total; ms++, now_ms++) {
+        for (int s = 0; s < scans_per_ms; s++) {
+            for (uint8_t r = 0; r < MATRIX_ROWS; r++) {
+                matrix_row_t raw = 0;
+                for (uint8_t c = 0; c < MATRIX_COLS; c++) {
+                    if (state_at(p->raw, p->len, (r * MATRIX_COLS + c) % PHASES, ms) == '1')
+                        raw |= ((matrix_row_t)1<<c);
+                }
+                debounce_row(r, raw, &matrix[r]);
+            }
+        }
+        for (uint8_t r = 0; r < MATRIX_ROWS; r++) {
+            for (uint8_t c = 0; c < MATRIX_COLS; c++) {
+                char want = state_at(p->want, p->len, (r * MATRIX_COLS + c) % PHASES, ms);
+                char got = (matrix[r] & ((matrix_row_t)1<<c)) ? '1' : '0';
+                if (got != want && ok) {
+                    printf("FAIL %s: %d scan/ms key %d,%d at %d ms: %c\n",
+                           p->name, scans_per_ms, r, c, ms, got);
+                    ok = false;
+                }
+            }
+        }
+    }
+    return ok;
+}
+
+static double bench(int scans, bool idle)
+{
+    static matrix_row_t frames[MAX_PATTERNS * MAX_LEN][MATRIX_ROWS];
+    struct timespec t0, t1;
+    int total = 0;
+
+    // raw rows of concatenated corpus, one scan per ms
+    for (int i = 0; i < pattern_count; i++) {
+        const pattern_t *p = &patterns[i];
+        for (int ms = 0; ms < p->len; ms++, total++) {
+            for (uint8_t r = 0; r < MATRIX_ROWS; r++) {
+                matrix_row_t raw = 0;
+                for (uint8_t c = 0; c < MATRIX_COLS && !idle; c++) {
+                    if (state_at(p->raw, p->len, (r * MATRIX_COLS + c) % PHASES, ms) == '1')
+                        raw |= ((matrix_row_t)1<<c);
+                }
+                frames[total][r] = raw;
+            }
+        }
+    }
+
+    now_ms = 1000;
+    debounce_init();
+    for (uint8_t r = 0; r < MATRIX_ROWS; r++) matrix[r] = 0;
+
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &t0);
+    for (int n = 0, f = 0; n < scans; n++, now_ms++) {
+        for (uint8_t r = 0; r < MATRIX_ROWS; r++) {
+            debounce_row(r, frames[f][r], &matrix[r]);
+        }
+        if (++f == total) f = 0;
+    }
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &t1);
+    double ns = (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+    return ns / ((double)scans * MATRIX_ROWS);
+}
+
+int main(int argc, char **argv)
+{
+    int scans = 1000000;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:")) != -1) {
+        switch (opt) {
+            case 'n': scans = atoi(optarg); break;
+            default:
+                fprintf(stderr, "usage: %s [-n scans] < corpus\n", argv[0]);
+                return 2;
+        }
+    }
+
+    read_corpus(stdin);
+    if (!pattern_count) {
+        fprintf(stderr, "no pattern\n");
+        return 2;
+    }
+
+    int fail = 0;
+    for (int i = 0; i < pattern_count; i++) {
+        if (!check(&patterns[i], 1) || !check(&patterns[i], 4)) fail++;
+    }
+    printf("%s: %d patterns, %d failed (press %dms, release %dms, %dx%d)\n", DEBOUNCE_NAME,
+           pattern_count, fail, DEBOUNCE_PRESS, DEBOUNCE_RELEASE, MATRIX_ROWS, MATRIX_COLS);
+
+    if (scans) {
+        printf("active: %.1f ns/row\n", bench(scans, false));
+        printf("idle:   %.1f ns/row\n", bench(scans, true));
+    }
+    return fail ? 1 : 0;
+}
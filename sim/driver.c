@@ -0,0 +1,115 @@
+/*
+Copyright 2013 Jun Wako <wakojun@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*
+ * Host simulator: host driver which records reports with time stamp
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "report.h"
+#include "host.h"
+#include "host_driver.h"
+#include "timer.h"
+#include "led.h"
+#include "sendchar.h"
+#include "latency.h"
+#include "sim.h"
+
+
+bool sim_quiet = false;
+static uint8_t host_leds = 0;
+
+static uint8_t keyboard_leds(void);
+static void send_keyboard(report_keyboard_t *report);
+static void send_mouse(report_mouse_t *report);
+static void send_system(uint16_t data);
+static void send_consumer(uint16_t data);
+host_driver_t sim_driver = {
+    keyboard_leds,
+    send_keyboard,
+    send_mouse,
+    send_system,
+    send_consumer
+};
+
+
+/* time stamp in us from virtual timer */
+static void print_time(void)
+{
+    uint32_t t = timer_read_fine();
+    printf("%10lu ", (unsigned long)TIMER_FINE_MS(t) * 1000 +
+                     (unsigned long)TIMER_FINE_RAW(t) * 1000 / (TIMER_RAW_TOP + 1));
+}
+
+void sim_host_leds(uint8_t leds)
+{
+    host_leds = leds;
+    host_keyboard_leds_changed();
+}
+
+static uint8_t keyboard_leds(void)
+{
+    return host_leds;
+}
+
+static void send_keyboard(report_keyboard_t *report)
+{
+    latency_mark(LATENCY_USB_SENT);
+    if (sim_quiet) return;
+    print_time();
+    printf("keyboard:");
+    for (uint8_t i = 0; i < sizeof(report_keyboard_t); i++) {
+        printf(" %02X", report->raw[i]);
+    }
+    printf("\n");
+}
+
+static void send_mouse(report_mouse_t *report)
+{
+    if (sim_quiet) return;
+    print_time();
+    printf("mouse: %02X %d %d %d %d\n", report->buttons,
+           report->x, report->y, report->v, report->h);
+}
+
+static void send_system(uint16_t data)
+{
+    if (sim_quiet) return;
+    print_time();
+    printf("system: %04X\n", data);
+}
+
+static void send_consumer(uint16_t data)
+{
+    if (sim_quiet) return;
+    print_time();
+    printf("consumer: %04X\n", data);
+}
+
+void led_set(uint8_t usb_led)
+{
+    if (sim_quiet) return;
+    print_time();
+    printf("led: %02X\n", usb_led);
+}
+
+/* console output goes to stderr */
+int8_t sendchar(uint8_t c)
+{
+    if (c != '\r') fputc(c, stderr);
+    return 0;
+}
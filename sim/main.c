@@ -0,0 +1,219 @@
+/*
+Copyright 2013 Jun Wako <wakojun@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*
+ * Host simulator of keyboard firmware
+ *
+ * Reads event script from stdin and writes host reports with time stamp in
+ * us to stdout. Console output goes to stderr.
+ *
+ * Script:
+ *   d <row> <col>  press key
+ *   u <row> <col>  release key
+ *   w <ms>         wait
+ *   l <hex>        set host keyboard LEDs
+ *   # ...          comment
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "sim.h"
+
+
+typedef struct {
+    char     cmd;
+    uint16_t arg1;
+    uint16_t arg2;
+} sim_event_t;
+
+static sim_event_t *script = NULL;
+static size_t script_len = 0;
+static size_t script_cap = 0;
+
+static uint8_t tasks_per_ms = 4;
+
+static void script_add(char cmd, uint16_t arg1, uint16_t arg2)
+{
+    if (script_len == script_cap) {
+        script_cap = script_cap ? script_cap * 2 : 256;
+        script = realloc(script, script_cap * sizeof(sim_event_t));
+        if (!script) {
+            perror("realloc");
+            exit(1);
+        }
+    }
+    script[script_len++] = (sim_event_t){ .cmd = cmd, .arg1 = arg1, .arg2 = arg2 };
+}
+
+static void script_load(FILE *f)
+{
+    char line[128];
+    unsigned int a, b;
+    unsigned long lineno = 0;
+
+    while (fgets(line, sizeof(line), f)) {
+        lineno++;
+        char *p = line + strspn(line, " \t");
+        if (*p == '#' || *p == '\n' || *p == '\0') continue;
+
+        switch (*p) {
+            case 'd':
+            case 'u':
+                if (sscanf(p + 1, "%u %u", &a, &b) != 2 || a >= sim_matrix_rows || b >= sim_matrix_cols)
+                    goto error;
+                script_add(*p, a, b);
+                break;
+            case 'w':
+                if (sscanf(p + 1, "%u", &a) != 1) goto error;
+                script_add(*p, a, 0);
+                break;
+            case 'l':
+                if (sscanf(p + 1, "%x", &a) != 1) goto error;
+                script_add(*p, a, 0);
+                break;
+            default:
+                goto error;
+        }
+    }
+    return;
+error:
+    fprintf(stderr, "script:%lu: invalid line: %s", lineno, line);
+    exit(1);
+}
+
+/* random typing: holds up to three keys at once */
+static void script_random(uint32_t n, unsigned int seed)
+{
+    uint8_t held_row[3], held_col[3];
+    uint8_t held = 0;
+
+    srand(seed);
+    for (uint32_t i = 0; i < n; i++) {
+        if (held == 3 || (held && rand() % 2)) {
+            uint8_t k = rand() % held;
+            script_add('u', held_row[k], held_col[k]);
+            held--;
+            held_row[k] = held_row[held];
+            held_col[k] = held_col[held];
+        } else {
+            uint8_t row = rand() % sim_matrix_rows;
+            uint8_t col = rand() % sim_matrix_cols;
+            bool dup = false;
+            for (uint8_t k = 0; k < held; k++) {
+                if (held_row[k] == row && held_col[k] == col) dup = true;
+            }
+            if (dup) continue;
+            script_add('d', row, col);
+            held_row[held] = row;
+            held_col[held] = col;
+            held++;
+        }
+        script_add('w', rand() % 80, 0);
+    }
+    while (held--) {
+        script_add('u', held_row[held], held_col[held]);
+    }
+    script_add('w', 500, 0);
+}
+
+static void play(void)
+{
+    for (size_t i = 0; i < script_len; i++) {
+        sim_event_t *e = &script[i];
+        switch (e->cmd) {
+            case 'd':
+                sim_matrix_set(e->arg1, e->arg2, true);
+                break;
+            case 'u':
+                sim_matrix_set(e->arg1, e->arg2, false);
+                break;
+            case 'w':
+                sim_run(e->arg1, tasks_per_ms);
+                break;
+            case 'l':
+                sim_host_leds(e->arg1);
+                break;
+        }
+    }
+    // let firmware see last change
+    sim_run(1, tasks_per_ms);
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [-d] [-t tasks_per_ms] [-b repeat] [-r events] [-s seed] < script\n"
+            "  -d  enable debug print\n"
+            "  -t  keyboard_task() calls per ms(default 4)\n"
+            "  -b  benchmark: play script repeatedly without report output\n"
+            "  -r  play random typing of given number of key events instead of script\n"
+            "  -s  seed for random typing\n", name);
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t repeat = 0;
+    uint32_t random_events = 0;
+    unsigned int seed = 1;
+    bool debug = false;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "dt:b:r:s:")) != -1) {
+        switch (opt) {
+            case 'd': debug = true; break;
+            case 't': tasks_per_ms = atoi(optarg); break;
+            case 'b': repeat = strtoul(optarg, NULL, 0); break;
+            case 'r': random_events = strtoul(optarg, NULL, 0); break;
+            case 's': seed = strtoul(optarg, NULL, 0); break;
+            default: usage(argv[0]);
+        }
+    }
+    if (tasks_per_ms == 0) usage(argv[0]);
+
+    if (random_events)
+        script_random(random_events, seed);
+    else
+        script_load(stdin);
+
+    sim_init(debug);
+
+    if (!repeat) {
+        play();
+        sim_finish();
+        return 0;
+    }
+
+    sim_quiet = true;
+    clock_t start = clock();
+    for (uint32_t i = 0; i < repeat; i++) {
+        play();
+    }
+    double sec = (double)(clock() - start) / CLOCKS_PER_SEC;
+    if (sec <= 0) sec = 1e-9;
+
+    fprintf(stderr, "keyboard:     %s\n", SIM_KEYBOARD);
+    fprintf(stderr, "events:       %lu\n", (unsigned long)sim_event_count);
+    fprintf(stderr, "task calls:   %lu\n", (unsigned long)sim_task_count);
+    fprintf(stderr, "cpu time:     %.3f s\n", sec);
+    fprintf(stderr, "events/sec:   %.0f\n", sim_event_count / sec);
+    fprintf(stderr, "tasks/sec:    %.0f\n", sim_task_count / sec);
+    return 0;
+}
@@ -0,0 +1,96 @@
+/*
+Copyright 2013 Jun Wako <wakojun@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*
+ * Host simulator: virtual matrix set by event script
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include "print.h"
+#include "timer.h"
+#include "matrix.h"
+#include "sim.h"
+
+
+const uint8_t sim_matrix_rows = MATRIX_ROWS;
+const uint8_t sim_matrix_cols = MATRIX_COLS;
+static matrix_row_t matrix[MATRIX_ROWS];
+
+
+void sim_matrix_set(uint8_t row, uint8_t col, bool on)
+{
+    if (row >= MATRIX_ROWS || col >= MATRIX_COLS) return;
+    if (!on != !matrix_is_on(row, col))
+        matrix_key_event(row, col, on, timer_read_fine());
+    if (on)
+        matrix[row] |= ((matrix_row_t)1<<col);
+    else
+        matrix[row] &= ~((matrix_row_t)1<<col);
+    matrix_dirty_mark(MATRIX_DIRTY_ROW(row));
+}
+
+void sim_matrix_clear(void)
+{
+    for (uint8_t i = 0; i < MATRIX_ROWS; i++) matrix[i] = 0;
+    matrix_dirty_mark(MATRIX_DIRTY_ALL);
+}
+
+uint8_t matrix_rows(void)
+{
+    return MATRIX_ROWS;
+}
+
+uint8_t matrix_cols(void)
+{
+    return MATRIX_COLS;
+}
+
+void matrix_init(void)
+{
+    sim_matrix_clear();
+}
+
+uint8_t matrix_scan(void)
+{
+    return 1;
+}
+
+bool matrix_is_modified(void)
+{
+    return true;
+}
+
+bool matrix_is_on(uint8_t row, uint8_t col)
+{
+    return (matrix[row] & ((matrix_row_t)1<<col));
+}
+
+matrix_row_t matrix_get_row(uint8_t row)
+{
+    return matrix[row];
+}
+
+void matrix_print(void)
+{
+    print("\nr/c 0123456789ABCDEF\n");
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        xprintf("%02X: ", row);
+        for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+            xputc(matrix_is_on(row, col) ? '1' : '0');
+        }
+        print("\n");
+    }
+}
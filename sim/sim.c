@@ -0,0 +1,85 @@
+/*
+Copyright 2013 Jun Wako <wakojun@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*
+ * Host simulator: firmware main loop on virtual time
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <avr/io.h>
+#include "keyboard.h"
+#include "host.h"
+#include "timer.h"
+#include "debug.h"
+#include "print.h"
+#include "bootloader.h"
+#include "trace.h"
+#include "sim.h"
+
+
+uint32_t sim_event_count = 0;
+uint32_t sim_task_count = 0;
+static uint32_t now = 0;
+
+/* scan interrupt handler defined with MATRIX_SCAN_ISR */
+void TIMER3_COMPA_vect(void) __attribute__ ((weak));
+
+
+/* count key events processed by action_exec(): linked with --wrap */
+void __real_action_exec(keyevent_t event);
+void __wrap_action_exec(keyevent_t event);
+void __wrap_action_exec(keyevent_t event)
+{
+    if (!IS_NOEVENT(event)) sim_event_count++;
+    __real_action_exec(event);
+}
+
+void sim_init(bool debug)
+{
+    host_set_driver(&sim_driver);
+    keyboard_init();
+    debug_enable = debug;
+    debug_keyboard = debug;
+}
+
+/* run firmware for ms: keyboard_task() is called tasks_per_ms times each ms */
+void sim_run(uint32_t ms, uint8_t tasks_per_ms)
+{
+    while (ms--) {
+        now++;
+        if (TIMER3_COMPA_vect && (TIMSK3 & _BV(OCIE3A))) {
+            sim_timer_set(now, 0);
+            TIMER3_COMPA_vect();
+        }
+        for (uint8_t t = 0; t < tasks_per_ms; t++) {
+            sim_timer_set(now, t * (TIMER_RAW_TOP + 1) / tasks_per_ms);
+            keyboard_task();
+            sim_task_count++;
+        }
+    }
+}
+
+/* dump recorded trace on console(stderr) for trace_decode */
+void sim_finish(void)
+{
+    trace_dump();
+}
+
+/* keymap may have a key for bootloader */
+void bootloader_jump(void)
+{
+    print("bootloader_jump: ignored\n");
+}
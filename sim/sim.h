@@ -0,0 +1,46 @@
+/*
+Copyright 2013 Jun Wako <wakojun@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "host_driver.h"
+
+
+/* firmware */
+extern uint32_t sim_event_count;    // key events processed by action_exec()
+extern uint32_t sim_task_count;     // keyboard_task() calls
+void sim_init(bool debug);
+void sim_run(uint32_t ms, uint8_t tasks_per_ms);
+void sim_finish(void);
+
+/* virtual matrix */
+extern const uint8_t sim_matrix_rows;
+extern const uint8_t sim_matrix_cols;
+void sim_matrix_set(uint8_t row, uint8_t col, bool on);
+void sim_matrix_clear(void);
+
+/* virtual timer */
+void sim_timer_set(uint32_t ms, uint8_t raw);
+
+/* recording host driver */
+extern host_driver_t sim_driver;
+extern bool sim_quiet;
+void sim_host_leds(uint8_t leds);
+
+#endif
@@ -0,0 +1,67 @@
+/*
+Copyright 2013 Jun Wako <wakojun@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*
+ * Host simulator: virtual timer driven by sim main loop
+ */
+#include <stdint.h>
+#include <avr/io.h>
+#include "timer.h"
+#include "sim.h"
+
+
+volatile uint32_t timer_count = 0;
+
+void sim_timer_set(uint32_t ms, uint8_t raw)
+{
+    timer_count = ms;
+    TCNT0 = raw;
+}
+
+void timer_init(void)
+{
+    OCR0A = TIMER_RAW_TOP;
+}
+
+void timer_clear(void)
+{
+    timer_count = 0;
+}
+
+uint16_t timer_read(void)
+{
+    return (timer_count & 0xFFFF);
+}
+
+uint32_t timer_read32(void)
+{
+    return timer_count;
+}
+
+uint32_t timer_read_fine(void)
+{
+    return (timer_count << 8) | TCNT0;
+}
+
+uint16_t timer_elapsed(uint16_t last)
+{
+    return TIMER_DIFF_16((timer_count & 0xFFFF), last);
+}
+
+uint32_t timer_elapsed32(uint32_t last)
+{
+    return TIMER_DIFF_32(timer_count, last);
+}
@@ -0,0 +1,137 @@
+/*
+Copyright 2013 Jun Wako <wakojun@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*
+ * Decoder of event trace dump(common/trace.c)
+ *
+ * Reads console log(hid_listen output or sim stderr) and prints timeline.
+ * Gap between records while key event is waiting for report and latency
+ * from key event to report longer than threshold are flagged with '!'.
+ *
+ * usage: trace_decode [-g ms] < console.log
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+
+enum {
+    TRACE_KEY = 1,
+    TRACE_PROCESS,
+    TRACE_LAYER,
+    TRACE_DEFAULT,
+    TRACE_REPORT,
+};
+
+static unsigned int gap_ms = 20;
+
+
+static bool parse_record(const char *line, uint8_t rec[7])
+{
+    const char *p = strchr(line, '~');
+    if (!p) return false;
+    p++;
+    for (int i = 0; i < 7; i++) {
+        unsigned int b;
+        if (sscanf(p + i * 2, "%2x", &b) != 1) return false;
+        rec[i] = b;
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    char line[256];
+    uint8_t rec[7];
+    bool first = true;
+    uint16_t prev = 0;
+    bool key_pending = false;
+    uint16_t key_time = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "g:")) != -1) {
+        switch (opt) {
+            case 'g':
+                gap_ms = strtoul(optarg, NULL, 0);
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-g ms] < console.log\n", argv[0]);
+                return 1;
+        }
+    }
+
+    printf("   time  delta\n");
+    while (fgets(line, sizeof(line), stdin)) {
+        if (strstr(line, "trace:")) {
+            // new dump starts
+            first = true;
+            key_pending = false;
+            printf("----\n");
+            continue;
+        }
+        if (!parse_record(line, rec)) continue;
+
+        uint8_t type = rec[0] & 0x0F;
+        uint8_t extra = rec[0] >> 4;
+        uint16_t time = rec[1] | rec[2] << 8;
+        uint32_t data = rec[3] | rec[4] << 8 | rec[5] << 16 | (uint32_t)rec[6] << 24;
+        uint16_t delta = first ? 0 : (uint16_t)(time - prev);
+
+        // idle time between key strokes is not a gap
+        bool gap = !first && key_pending && delta > gap_ms;
+        printf("%c%6u %6u  ", gap ? '!' : ' ', time, delta);
+        switch (type) {
+            case TRACE_KEY:
+                printf("key     r%02X c%02X %s\n", rec[3], rec[4], rec[5] ? "down" : "up");
+                if (!key_pending) {
+                    key_pending = true;
+                    key_time = time;
+                }
+                break;
+            case TRACE_PROCESS:
+                printf("process r%02X c%02X %s tap=%u%s\n", rec[3], rec[4],
+                       (rec[5] & 0x0F) ? "down" : "up", rec[6],
+                       (rec[5] & 0x10) ? " interrupted" : "");
+                break;
+            case TRACE_LAYER:
+                printf("layer   %08lX\n", (unsigned long)data);
+                break;
+            case TRACE_DEFAULT:
+                printf("default %08lX\n", (unsigned long)data);
+                break;
+            case TRACE_REPORT:
+                printf("report  mods=%02X keys=%u:", rec[3], extra);
+                for (int i = 0; i < 3 && i < extra; i++) printf(" %02X", rec[4 + i]);
+                if (extra > 3) printf(" ...");
+                if (key_pending) {
+                    uint16_t latency = time - key_time;
+                    printf("  latency=%u%s", latency, latency > gap_ms ? " !" : "");
+                    key_pending = false;
+                }
+                printf("\n");
+                break;
+            default:
+                printf("unknown %02X\n", rec[0]);
+                break;
+        }
+        prev = time;
+        first = false;
+    }
+    return 0;
+}
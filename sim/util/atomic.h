@@ -0,0 +1,8 @@
+#ifndef SIM_UTIL_ATOMIC_H
+#define SIM_UTIL_ATOMIC_H
+
+#define ATOMIC_BLOCK(type)  for (int __done = 0; !__done; __done = 1)
+#define ATOMIC_RESTORESTATE
+#define ATOMIC_FORCEON
+
+#endif
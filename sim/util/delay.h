@@ -0,0 +1,8 @@
+#ifndef SIM_UTIL_DELAY_H
+#define SIM_UTIL_DELAY_H
+
+/* busy wait doesn't advance virtual time */
+#define _delay_ms(ms)
+#define _delay_us(us)
+
+#endif
@@ -0,0 +1,166 @@
+/*
+ * Host simulator: C implementation of common/xprintf.S
+ *
+ * Argument without 'l' is 16bit and with 'l' is 32bit like AVR.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include "xprintf.h"
+
+
+void (*xfunc_out)(uint8_t);
+
+static char *out_str;
+
+void xputc(char chr)
+{
+    if (out_str) {
+        *out_str++ = chr;
+    } else if (xfunc_out) {
+        xfunc_out(chr);
+    }
+}
+
+void xputs(const char *string_p)
+{
+    while (*string_p) xputc(*string_p++);
+}
+
+void xitoa(long value, char radix, char width)
+{
+    char buf[33];
+    char pad = ' ';
+    bool neg = false;
+    uint32_t v = (uint32_t)value;
+    uint8_t i = 0;
+
+    // negative radix means signed value
+    if (radix < 0) {
+        radix = -radix;
+        if ((int32_t)v < 0) {
+            neg = true;
+            v = -(int32_t)v;
+        }
+    }
+    if (width < 0) {
+        width = -width;
+        pad = '0';
+    }
+    do {
+        uint8_t d = v % radix;
+        buf[i++] = d < 10 ? '0' + d : 'A' + d - 10;
+        v /= radix;
+    } while (v);
+    if (neg) buf[i++] = '-';
+    while (i < width && i < sizeof(buf)) buf[i++] = pad;
+    while (i) xputc(buf[--i]);
+}
+
+static void xvprintf(const char *fmt, va_list ap)
+{
+    char c;
+
+    while ((c = *fmt++)) {
+        if (c != '%') {
+            xputc(c);
+            continue;
+        }
+
+        char pad = ' ';
+        uint8_t width = 0;
+        bool is_long = false;
+
+        c = *fmt++;
+        if (c == '0') {
+            pad = '0';
+            c = *fmt++;
+        }
+        while (c >= '0' && c <= '9') {
+            width = width * 10 + c - '0';
+            c = *fmt++;
+        }
+        if (c == 'l') {
+            is_long = true;
+            c = *fmt++;
+        }
+
+        uint8_t radix;
+        switch (c) {
+            case 'c':
+                xputc(va_arg(ap, int));
+                continue;
+            case 's':
+            case 'S':
+                xputs(va_arg(ap, const char *));
+                continue;
+            case 'd':
+            case 'u':
+                radix = 10;
+                break;
+            case 'X':
+            case 'x':
+                radix = 16;
+                break;
+            case 'b':
+                radix = 2;
+                break;
+            case '\0':
+                return;
+            default:
+                xputc(c);
+                continue;
+        }
+
+        uint32_t v = is_long ? va_arg(ap, uint32_t) : (uint16_t)va_arg(ap, unsigned int);
+        bool neg = false;
+        if (c == 'd') {
+            int32_t s = is_long ? (int32_t)v : (int16_t)v;
+            if (s < 0) {
+                neg = true;
+                v = -s;
+            }
+        }
+
+        char buf[33];
+        uint8_t i = 0;
+        do {
+            uint8_t d = v % radix;
+            buf[i++] = d < 10 ? '0' + d : 'A' + d - 10;
+            v /= radix;
+        } while (v);
+        if (neg) buf[i++] = '-';
+        while (i < width && i < sizeof(buf)) buf[i++] = pad;
+        while (i) xputc(buf[--i]);
+    }
+}
+
+void __xprintf(const char *format_p, ...)
+{
+    va_list ap;
+    va_start(ap, format_p);
+    xvprintf(format_p, ap);
+    va_end(ap);
+}
+
+void __xsprintf(char *str, const char *format_p, ...)
+{
+    va_list ap;
+    out_str = str;
+    va_start(ap, format_p);
+    xvprintf(format_p, ap);
+    va_end(ap);
+    *out_str = 0;
+    out_str = 0;
+}
+
+void __xfprintf(void(*func)(uint8_t), const char *format_p, ...)
+{
+    void (*pf)(uint8_t) = xfunc_out;
+    va_list ap;
+    xfunc_out = func;
+    va_start(ap, format_p);
+    xvprintf(format_p, ap);
+    va_end(ap);
+    xfunc_out = pf;
+}